@@ -1,10 +1,10 @@
 bl_info = {
     "name": "Alias Triangle File - Import Script",
     "author": "Pup Luka (Troubleshooting by Paril)",
-    "version": (2, 2),
+    "version": (2, 3),
     "blender": (2, 80, 0),
     "location": "File > Import",
-    "description": "Imports official Quake 1/2 .TRI mesh files, correctly parsing the trilib.c object/group structure including vertex data padding.",
+    "description": "Imports official Quake 1/2 .TRI mesh files, correctly parsing the trilib.c object/group structure including vertex data padding. A sequence of <base>_frameN.tri files, or a mdl2tri .pak container, imports as shape keys on one mesh.",
     "warning": "This script expects a magic number (0x0001E1BA). It strictly adheres to the Alias/trilib.c file format for all expected data. It may not work with simplified or other non-standard .tri files.",
     "doc_url": "",
     "category": "Import-Export",
@@ -14,6 +14,12 @@ import bpy
 import struct
 import os
 import math
+import re
+import time
+
+# Blender ships numpy with its Python. The triangle blocks are read with one
+# numpy.frombuffer call each, instead of one struct.unpack per aliaspoint_t.
+import numpy as np
 
 # This has been changed to match the '00 01 E1 BA' sequence when interpreted as Big-Endian.
 # The original listed magic was 123322 (0x0001EBA2). [VERY VERY WRONG] ~luka
@@ -26,161 +32,291 @@ FLOAT_END_VALUE = -99999.0
 # Epsilon for float comparisons to handle minor precision differences
 FLOAT_EPSILON = 0.0001
 
+# An 'aliaspoint_t' is 11 Big-Endian floats: n.xyz, p.xyz, c.xyz, u, v (44 bytes).
+# Three of them make a triangle (132 bytes).
+POINT_FLOATS = 11
+TRIANGLE_BYTES = 3 * POINT_FLOATS * 4
+
+# Frame files as mdl2tri names them: <base>_frame5.tri, or <base>_frame5_sub2.tri
+# for a sub-frame of a frame group.
+FRAME_FILE_RE = re.compile(r'^(?P<base>.+)_frame(?P<frame>\d+)(?:_sub(?P<sub>\d+))?\.tri$', re.IGNORECASE)
+
+# PAK container: "PACK", directory offset and length, then 64-byte entries of
+# a 56-byte name, offset and length (all Little-Endian).
+PAK_MAGIC = b'PACK'
+PAK_ENTRY_SIZE = 64
+PAK_NAME_SIZE = 56
+
+
+def read_cstring(data, pos, end):
+    """
+    Reads a null-terminated ASCII string at pos. Returns the string and the position after it.
+    """
+    term = data.find(b'\0', pos, end)
+    if term < 0:
+        raise IOError(f"Unterminated string at pos {pos}.")
+    return data[pos:term].decode('ascii', errors='ignore'), term + 1
+
+
+def parse_tri(data, start=0, end=None, verbose=True):
+    """
+    Parses a Quake 1/2 .tri file held in data[start:end], following the trilib.c object/group structure.
+    Returns a list of (object_name, texture_name, points) for every object with triangles, where points
+    is a (num_triangles, 3, 11) float32 array of the aliaspoint_t floats, read in one bulk call.
+    """
+    if end is None:
+        end = len(data)
+    if end - start < 4:
+        raise IOError("Too short to contain a magic number.")
+
+    # 1. Read Magic Number (4 bytes, Big-Endian)
+    magic = struct.unpack_from('>I', data, start)[0]
+    if magic != Q1_TRI_MAGIC:
+        print(f"DEBUG: Read Magic: 0x{magic:08X} (Decimal: {magic}). Expected 0x{Q1_TRI_MAGIC:08X} (Decimal: {Q1_TRI_MAGIC}).")
+        raise ValueError(f"Magic number mismatch. Expected 0x{Q1_TRI_MAGIC:08X}, got 0x{magic:08X}.")
+
+    objects = []
+    pos = start + 4
+    # Keep reading object chunks until End-Of-File
+    while pos < end:
+        if end - pos < 4:
+            print(f"Warning: Partial read ({end - pos} bytes) at end of file. Possible truncation.")
+            break
+
+        # Unpack the header marker as a Big-Endian float
+        header_marker = struct.unpack_from('>f', data, pos)[0]
+
+        # Check for the FLOAT_END marker
+        if math.isclose(header_marker, FLOAT_END_VALUE, rel_tol=FLOAT_EPSILON):
+            # After FLOAT_END, the trilib parser reads another object name (a redundancy).
+            obj_end_name, pos = read_cstring(data, pos + 4, end)
+            if verbose:
+                print(f"  Object End Name: '{obj_end_name}'")
+            continue
+
+        # Anything but FLOAT_START here means an unexpected format
+        if not math.isclose(header_marker, FLOAT_START_VALUE, rel_tol=FLOAT_EPSILON):
+            raise ValueError(f"Unexpected header pattern at pos {pos - start}: {header_marker} (raw: {bytes(data[pos:pos + 4]).hex()}). File may be corrupted or not a valid .tri file.")
+
+        object_name, pos = read_cstring(data, pos + 4, end)
+
+        # Read Number of Triangles for this object (4 bytes, Big-Endian signed int)
+        if end - pos < 4:
+            raise IOError("File is too short to contain triangle count.")
+        num_triangles = struct.unpack_from('>i', data, pos)[0]
+        pos += 4
+        if verbose:
+            print(f"  Object Name: '{object_name}', Triangle Count: {num_triangles}")
+
+        if num_triangles < 0 or num_triangles > 200000: # Sanity check for extremely large models
+            raise ValueError(f"Suspicious number of triangles ({num_triangles}). File may be corrupted.")
+        if num_triangles == 0:
+            # A group: no texture name and no triangles follow
+            continue
+
+        # Read Texture Name (null-terminated string) if triangles exist
+        texture_name, pos = read_cstring(data, pos, end)
+
+        # --- Read Triangle Data ---
+        # The whole block at once, converted from Big-Endian to native floats
+        if end - pos < num_triangles * TRIANGLE_BYTES:
+            raise IOError(f"Unexpected EOF while reading the {num_triangles} triangles of '{object_name}'.")
+        points = np.frombuffer(data, dtype='>f4', count=num_triangles * 3 * POINT_FLOATS, offset=pos)
+        points = points.astype(np.float32).reshape(num_triangles, 3, POINT_FLOATS)
+        pos += num_triangles * TRIANGLE_BYTES
+        objects.append((object_name, texture_name, points))
+
+    return objects
+
+
+def weld_vertices(positions):
+    """
+    Welds triangle corners into shared vertices. positions is a (corners, k) array: the corner's
+    position, or its positions in every frame side by side, so corners only merge if they coincide
+    in all frames. Returns the corner index of every vertex, and the vertex of every corner, with
+    vertices in the order they first appear.
+    """
+    # Adding 0.0 turns -0.0 into 0.0, so the two compare equal as bytes
+    rows = np.ascontiguousarray(positions + np.float32(0.0))
+    keys = rows.view(np.dtype((np.void, rows.dtype.itemsize * rows.shape[1]))).ravel()
+    _, first, inverse = np.unique(keys, return_index=True, return_inverse=True)
+    order = np.argsort(first)
+    remap = np.empty_like(order)
+    remap[order] = np.arange(len(order))
+    return first[order], remap[inverse.ravel()]
+
 
-def read_tri_data(context, filepath):
+def build_mesh(context, name, frames, frame_names):
     """
-    Reads a Quake 1/2 .tri file and imports its objects into Blender.
-    This script adheres to the Quake trilib.c parsing logic, but with a flexible magic number.
+    Creates one mesh object from frames, a (num_frames, num_triangles, 3, 11) array of aliaspoint_t
+    floats sharing one topology. With more than one frame, every frame becomes a shape key.
+    All mesh data goes in through foreach_set.
+    """
+    num_frames, num_triangles = frames.shape[0], frames.shape[1]
+    corners = num_triangles * 3
+
+    # The vertex position (p) is float 3, 4 and 5 of every aliaspoint_t
+    positions = frames[:, :, :, 3:6].reshape(num_frames, corners, 3)
+    first, corner_verts = weld_vertices(positions.transpose(1, 0, 2).reshape(corners, num_frames * 3))
+
+    mesh = bpy.data.meshes.new(name + "_mesh")
+    mesh.vertices.add(len(first))
+    mesh.vertices.foreach_set("co", positions[0, first].ravel())
+    mesh.loops.add(corners)
+    mesh.loops.foreach_set("vertex_index", corner_verts.astype(np.int32))
+    mesh.polygons.add(num_triangles)
+    mesh.polygons.foreach_set("loop_start", np.arange(0, corners, 3, dtype=np.int32))
+    if bpy.app.version < (4, 0, 0):
+        # Derived from loop_start (and read-only) from Blender 4.0 on
+        mesh.polygons.foreach_set("loop_total", np.full(num_triangles, 3, dtype=np.int32))
+
+    # u, v are floats 9 and 10, with v counted from the top of the skin
+    uvs = frames[0, :, :, 9:11].reshape(corners, 2).copy()
+    uvs[:, 1] = 1.0 - uvs[:, 1]
+    mesh.uv_layers.new(name="UVMap").data.foreach_set("uv", uvs.ravel())
+    mesh.update(calc_edges=True)
+
+    obj = bpy.data.objects.new(name, mesh)
+    # Link the object to the active collection and make it active for context
+    context.collection.objects.link(obj)
+    context.view_layer.objects.active = obj
+    obj.select_set(True)
+
+    if num_frames > 1:
+        obj.shape_key_add(name="Basis", from_mix=False)
+        for f in range(num_frames):
+            key = obj.shape_key_add(name=frame_names[f], from_mix=False)
+            key.data.foreach_set("co", positions[f, first].ravel())
+
+    print(f"Imported '{name}': {num_triangles} triangles, {len(first)} vertices, {num_frames} frame(s).")
+    return obj
+
+
+def frame_key(filename):
+    """
+    Sort key for mdl2tri frame file names: frame number, then sub-frame (single frames first).
+    Other names sort last, by name.
+    """
+    m = FRAME_FILE_RE.match(filename)
+    if not m:
+        return (math.inf, 0, filename)
+    return (int(m.group('frame')), int(m.group('sub') or -1), filename)
+
+
+def frame_sequence(filepath):
+    """
+    The <base>_frameN.tri and <base>_frameN_subM.tri files next to filepath, in frame order,
+    or just filepath if it is not named like a frame file.
+    """
+    directory, filename = os.path.split(filepath)
+    m = FRAME_FILE_RE.match(filename)
+    if not m:
+        return [filepath]
+    names = [name for name in os.listdir(directory or '.')
+             if FRAME_FILE_RE.match(name) and FRAME_FILE_RE.match(name).group('base') == m.group('base')]
+    return [os.path.join(directory, name) for name in sorted(names, key=frame_key)]
+
+
+def frame_name(filename):
+    """
+    Shape key name for a frame file: "frame5" or "frame5_sub2".
+    """
+    filename = os.path.basename(filename)
+    m = FRAME_FILE_RE.match(filename)
+    if not m:
+        return os.path.splitext(filename)[0]
+    return filename[len(m.group('base')) + 1:-len('.tri')]
+
+
+def join_objects(objects, source):
+    """
+    All the triangles of one parsed .tri file as one (num_triangles, 3, 11) array.
+    """
+    if not objects:
+        raise ValueError(f"No geometry data in '{source}'.")
+    return np.concatenate([points for _, _, points in objects])
+
+
+def import_frames(context, name, sources):
+    """
+    Imports frames as shape keys on one mesh. sources is a list of (frame name, data, start, end)
+    holding one .tri file each; they must all have the same triangle count.
+    """
+    frames = []
+    for fname, data, start, end in sources:
+        points = join_objects(parse_tri(data, start, end, verbose=False), fname)
+        if frames and points.shape != frames[0].shape:
+            raise ValueError(f"Frame '{fname}' has {points.shape[0]} triangles, expected {frames[0].shape[0]}.")
+        frames.append(points)
+    return build_mesh(context, name, np.stack(frames), [source[0] for source in sources])
+
+
+def read_pak_frames(filepath):
+    """
+    The .tri entries of a mdl2tri .pak container, in frame order, as (frame name, data, start, end).
+    """
+    with open(filepath, 'rb') as f:
+        data = f.read()
+    if len(data) < 12 or data[:4] != PAK_MAGIC:
+        raise ValueError(f"'{filepath}' is not a PAK file.")
+    dirofs, dirlen = struct.unpack_from('<ii', data, 4)
+    if dirofs < 12 or dirlen < 0 or dirofs + dirlen > len(data):
+        raise ValueError(f"'{filepath}' has a damaged directory.")
+
+    entries = []
+    for i in range(dirlen // PAK_ENTRY_SIZE):
+        pos = dirofs + i * PAK_ENTRY_SIZE
+        name = data[pos:pos + PAK_NAME_SIZE].split(b'\0', 1)[0].decode('ascii', errors='ignore')
+        filepos, filelen = struct.unpack_from('<ii', data, pos + PAK_NAME_SIZE)
+        if not FRAME_FILE_RE.match(name):
+            continue    # Skins and other entries
+        if filepos < 0 or filelen < 0 or filepos + filelen > len(data):
+            raise ValueError(f"Entry '{name}' of '{filepath}' lies outside the file.")
+        entries.append((name, filepos, filepos + filelen))
+    if not entries:
+        raise ValueError(f"'{filepath}' holds no .tri frames.")
+    entries.sort(key=lambda e: frame_key(e[0]))
+    return [(frame_name(name), data, start, end) for name, start, end in entries]
+
+
+def read_tri_data(context, filepath, sequence=True, files=None):
+    """
+    Imports a Quake 1/2 .tri file into Blender, one object per object block. With sequence, the
+    frame files of the same model next to it (or the frames of a .pak container, or the files
+    selected together) are imported instead, as shape keys on one mesh.
     """
     print(f"Importing Quake .tri file: {filepath}")
+    started = time.perf_counter()
 
     try:
-        with open(filepath, 'rb') as f:
-            # 1. Read Magic Number (4 bytes, Big-Endian)
-            magic_bytes = f.read(4)
-            if len(magic_bytes) < 4:
-                raise IOError(f"File '{filepath}' is too short to contain a magic number.")
-
-            # Unpack the magic number as a Big-Endian unsigned integer
-            magic = struct.unpack('>I', magic_bytes)[0]
-
-            # Check if the read magic number matches our expected (potentially non-standard) value
-            if magic != Q1_TRI_MAGIC:
-                print(f"DEBUG: Read Magic: 0x{magic:08X} (Decimal: {magic}). Expected 0x{Q1_TRI_MAGIC:08X} (Decimal: {Q1_TRI_MAGIC}).")
-                raise ValueError(f"Magic number mismatch. Expected 0x{Q1_TRI_MAGIC:08X}, got 0x{magic:08X}.")
+        if filepath.lower().endswith('.pak'):
+            sources = read_pak_frames(filepath)
+            name = os.path.splitext(os.path.basename(filepath))[0]
+            import_frames(context, name, sources)
+        else:
+            paths = [filepath]
+            if files and len(files) > 1:
+                paths = sorted(files, key=lambda path: frame_key(os.path.basename(path)))
+            elif sequence:
+                paths = frame_sequence(filepath)
+
+            if len(paths) > 1:
+                sources = []
+                for path in paths:
+                    with open(path, 'rb') as f:
+                        data = f.read()
+                    sources.append((frame_name(path), data, 0, len(data)))
+                m = FRAME_FILE_RE.match(os.path.basename(paths[0]))
+                import_frames(context, m.group('base') if m else os.path.splitext(os.path.basename(paths[0]))[0], sources)
             else:
-                print(f"Read Magic: 0x{magic:08X} - OK")
-
-            # Keep reading object chunks until End-Of-File
-            while True:
-                current_pos = f.tell()
-                header_marker_bytes = f.read(4)
-
-                if not header_marker_bytes: # Reached EOF cleanly
-                    print("Reached end of file.")
-                    break
-                
-                if len(header_marker_bytes) < 4:
-                    print(f"Warning: Partial read ({len(header_marker_bytes)} bytes) at end of file. Possible truncation.")
-                    break
-
-                # Unpack the header marker as a Big-Endian float
-                header_marker = struct.unpack('>f', header_marker_bytes)[0]
-
-                # Check for the FLOAT_END marker
-                if math.isclose(header_marker, FLOAT_END_VALUE, rel_tol=FLOAT_EPSILON):
-                    print(f"Read FLOAT_END marker at pos {current_pos}.")
-                    # After FLOAT_END, the trilib parser reads another object name (a redundancy).
-                    name_bytes = bytearray()
-                    while True:
-                        byte = f.read(1)
-                        if not byte or byte == b'\0':
-                            break
-                        name_bytes.extend(byte)
-                    obj_end_name = name_bytes.decode('ascii', errors='ignore')
-                    print(f"  Object End Name: '{obj_end_name}'")
-                    # Continue the loop to look for the next FLOAT_START
-                    continue
-                
-                # Check for the FLOAT_START marker (beginning of a new object)
-                elif math.isclose(header_marker, FLOAT_START_VALUE, rel_tol=FLOAT_EPSILON):
-                    print(f"Read FLOAT_START marker at pos {current_pos}. Beginning a new object.")
-
-                    # Read Object Name (null-terminated string)
-                    name_bytes = bytearray()
-                    while True:
-                        byte = f.read(1)
-                        if not byte or byte == b'\0':
-                            break
-                        name_bytes.extend(byte)
-                    
-                    object_name_from_file = name_bytes.decode('ascii', errors='ignore')
-                    print(f"  Object Name: '{object_name_from_file}'")
-
-                    # Read Number of Triangles for this object (4 bytes, Big-Endian signed int)
-                    num_triangles_bytes = f.read(4)
-                    if len(num_triangles_bytes) < 4:
-                        raise IOError("File is too short to contain triangle count.")
-                    
-                    num_triangles = struct.unpack('>i', num_triangles_bytes)[0]
-                    print(f"  Triangle Count: {num_triangles}")
-
-                    if num_triangles < 0 or num_triangles > 200000: # Sanity check for extremely large models
-                        raise ValueError(f"Suspicious number of triangles ({num_triangles}). File may be corrupted.")
-                    
-                    if num_triangles > 0:
-                        # Read Texture Name (null-terminated string) if triangles exist
-                        tex_name_bytes = bytearray()
-                        while True:
-                            byte = f.read(1)
-                            if not byte or byte == b'\0':
-                                break
-                            tex_name_bytes.extend(byte)
-                        
-                        texture_name_from_file = tex_name_bytes.decode('ascii', errors='ignore')
-                        print(f"  Texture Name: '{texture_name_from_file}'")
-
-                        # --- Read Triangle Data ---
-                        # Each triangle in the .tri file is stored as 3 'aliaspoint_t' structures.
-                        # An 'aliaspoint_t' is comprised of:
-                        # - vector n (normal): 3 floats
-                        # - vector p (point/position): 3 floats
-                        # - vector c (color): 3 floats
-                        # - float u, v (texture coordinates): 2 floats
-                        # Total: 11 floats per aliaspoint_t = 44 bytes per vertex.
-                        # Total: 3 vertices * 44 bytes/vertex = 132 bytes per triangle.
-
-                        verts = []
-                        faces = []
-                        for i in range(num_triangles):
-                            # For each of the 3 vertices in the current triangle
-                            for v_idx_in_tri in range(3):
-                                # Read 11 Big-Endian floats (44 bytes) for the aliaspoint_t structure
-                                alias_point_data_bytes = f.read(44)
-                                if len(alias_point_data_bytes) < 44:
-                                    raise IOError(f"Unexpected EOF while reading aliaspoint_t for triangle {i+1}, vertex {v_idx_in_tri+1}.")
-                                
-                                # Unpack all 11 floats from the bytes
-                                # n.x, n.y, n.z, p.x, p.y, p.z, c.x, c.y, c.z, u, v
-                                all_floats = struct.unpack('>11f', alias_point_data_bytes)
-                                
-                                # The vertex position (p) is the 4th, 5th, and 6th float (index 3, 4, 5)
-                                px, py, pz = all_floats[3], all_floats[4], all_floats[5]
-                                
-                                verts.append((px, py, pz))
-                            
-                            # Define the face using the last 3 vertices added to the list.
-                            # Blender faces use indices relative to the mesh's vertex list.
-                            v0_idx = len(verts) - 3
-                            v1_idx = len(verts) - 2
-                            v2_idx = len(verts) - 1
-                            faces.append((v0_idx, v1_idx, v2_idx))
-
-                        # Create the mesh and object in Blender
-                        mesh_name = object_name_from_file + "_mesh"
-                        obj_name = object_name_from_file
-                        mesh = bpy.data.meshes.new(mesh_name)
-                        obj = bpy.data.objects.new(obj_name, mesh)
-                        
-                        # Link the object to the active collection and make it active for context
-                        bpy.context.collection.objects.link(obj)
-                        bpy.context.view_layer.objects.active = obj
-                        obj.select_set(True)
-
-                        if verts and faces:
-                            # Populate the mesh with vertex and face data
-                            mesh.from_pydata(verts, [], faces)
-                            # Update the mesh to apply changes and recalculate normals implicitly
-                            mesh.update()
-                            print(f"Successfully imported {len(faces)} triangles for object '{object_name_from_file}'.")
-                        else:
-                            print(f"Warning: No geometry data read for object '{object_name_from_file}'. Created an empty object.")
-                    else:
-                        print(f"Object '{object_name_from_file}' has 0 triangles. Skipping geometry import.")
-
-                # If the header marker is neither FLOAT_START nor FLOAT_END, it's an unexpected format.
-                else:
-                    raise ValueError(f"Unexpected header pattern at pos {current_pos}: {header_marker} (raw: {header_marker_bytes.hex()}). File may be corrupted or not a valid .tri file.")
+                with open(filepath, 'rb') as f:
+                    data = f.read()
+                objects = parse_tri(data)
+                if not objects:
+                    print(f"Warning: No geometry data read from '{filepath}'.")
+                for object_name, texture_name, points in objects:
+                    print(f"  Texture Name: '{texture_name}'")
+                    build_mesh(context, object_name, points[np.newaxis], [object_name])
 
     except FileNotFoundError:
         print(f"Error: File not found at '{filepath}'")
@@ -195,13 +331,14 @@ def read_tri_data(context, filepath):
         print(f"An unexpected error occurred: {e}")
         return {'CANCELLED'}
 
+    print(f"Import finished in {time.perf_counter() - started:.2f}s.")
     return {'FINISHED'}
 
 
 # Blender boilerplate for registration
 from bpy_extras.io_utils import ImportHelper
-from bpy.props import StringProperty
-from bpy.types import Operator
+from bpy.props import StringProperty, BoolProperty, CollectionProperty
+from bpy.types import Operator, OperatorFileListElement
 
 
 class ImportTriOfficial(Operator, ImportHelper):
@@ -211,19 +348,36 @@ class ImportTriOfficial(Operator, ImportHelper):
 
     filename_ext = ".tri"
 
-    # Define a filter for the file browser to show only .tri files
+    # Define a filter for the file browser to show only .tri files (and mdl2tri containers)
     filter_glob: StringProperty(
-        default="*.tri",
+        default="*.tri;*.pak",
         options={'HIDDEN'}, # Hidden means it's applied automatically, not selectable by user
         maxlen=255,
     )
 
+    # Several files selected in the browser import together as one frame sequence
+    files: CollectionProperty(
+        type=OperatorFileListElement,
+        options={'HIDDEN', 'SKIP_SAVE'},
+    )
+    directory: StringProperty(
+        subtype='DIR_PATH',
+        options={'HIDDEN', 'SKIP_SAVE'},
+    )
+
+    import_sequence: BoolProperty(
+        name="Frame Sequence as Shape Keys",
+        description="Import every <base>_frameN.tri next to the selected file as a shape key on one mesh",
+        default=True,
+    )
+
     def execute(self, context):
         """
         Main execution method called by Blender when the import operator is run.
         """
         # Call our custom function to read and import the .tri data
-        return read_tri_data(context, self.filepath)
+        files = [os.path.join(self.directory, f.name) for f in self.files if f.name]
+        return read_tri_data(context, self.filepath, self.import_sequence, files)
 
 
 def menu_func_import(self, context):
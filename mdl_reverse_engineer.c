@@ -3,25 +3,60 @@
 #include <string.h>
 #include <stdarg.h> // For va_list, vprintf
 #include <errno.h>  // For strerror
-#include <math.h>   // For sqrtf
+#include <limits.h> // For INT_MAX
+#include <stdint.h> // For SIZE_MAX
+#include <math.h>   // For floor, sqrtf
+#include <setjmp.h> // For per-model error recovery
+#include <pthread.h>
+#include <dirent.h> // For directory scanning in batch mode
+#include <sys/stat.h>
+#include <time.h>   // For clock_gettime
+#include <signal.h> // For stopping --watch
 
-// Define missing common types and structures from Quake's original code
-#ifndef __BYTEBOOL__
-#define __BYTEBOOL__
-typedef enum {false, true} qboolean;
-typedef unsigned char byte;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
 #endif
 
-typedef float vec3_t[3];
+#ifdef _WIN32
+#include <fcntl.h>    // For _O_BINARY
+#include <io.h>       // For _setmode
+#include <direct.h>   // For _mkdir
+#else
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For close
+#include <sys/mman.h> // For mmap, munmap
+#endif
+#ifdef __linux__
+#include <sys/inotify.h> // For --watch
+#include <poll.h>
+#endif
+
+// Model parsing, frame decoding and the MDL structures live in libmdl
+#include "mdllib.h"
 
 // --- Dummy definitions for cmdlib.h functions ---
 // These are simplified implementations of functions found in cmdlib.c
 // necessary for basic file I/O and error handling.
 
-// Error function: Prints an error message and exits the program.
+// Per-thread error recovery: while a worker thread is converting a model it points
+// error_jmp at its own jmp_buf, so Error() abandons just that model instead of
+// the whole batch.
+static __thread jmp_buf *error_jmp;
+static __thread char error_message[1024];
+
+// Error function: Prints an error message and exits the program, or, inside a
+// model conversion, records the message and unwinds to the conversion's handler.
 void Error (char *error, ...)
 {
 	va_list argptr;
+	if (error_jmp) {
+		va_start (argptr,error);
+		vsnprintf (error_message, sizeof(error_message), error, argptr);
+		va_end (argptr);
+		longjmp (*error_jmp, 1);
+	}
 	fprintf(stderr, "************ ERROR ************\n");
 	va_start (argptr,error);
 	vfprintf (stderr, error, argptr);
@@ -39,6 +74,8 @@ int filelength (FILE *f)
 	fseek (f, 0, SEEK_END);
 	end = ftell (f);
 	fseek (f, pos, SEEK_SET); // Restore original position
+	if (end > INT_MAX)
+		return -1; // Not representable; callers treat it as an unknown size
 	return (int)end;
 }
 
@@ -86,42 +123,285 @@ void SaveFile (char *filename, void *buffer, int count)
 	fclose (f);
 }
 
-// --- Byte Order Conversion Functions ---
-// MDL files are Little-Endian. LBM and .tri files are Big-Endian.
-// These functions convert from the file's endianness to the host's endianness
-// when reading, and from host to target endianness when writing.
-// Assuming host system is Little-Endian (e.g., x86 processors).
+// Q_mkdir: Creates a directory; one that already exists is not an error.
+void Q_mkdir (char *path)
+{
+#ifdef _WIN32
+	if (_mkdir (path) != -1)
+		return;
+#else
+	if (mkdir (path, 0777) != -1)
+		return;
+#endif
+	if (errno != EEXIST)
+		Error ("mkdir %s: %s", path, strerror(errno));
+}
+
+// --- Output Directory ---
+// With --outdir, the directory is opened once and every output, manifest and
+// container is created relative to that handle with openat, so output names are
+// short paths inside it and the directory's own path is not resolved again for
+// each of them. Without --outdir the handle is the working directory and names
+// are used as given. Windows has no openat; there the names are joined to the
+// --outdir path instead.
+typedef enum { OUTDIR_FLAT, OUTDIR_MODEL, OUTDIR_HASHED } outdirlayout_t;
+
+char            *output_dir;            // --outdir, or NULL
+outdirlayout_t  output_dir_layout;      // --outdir-layout
+#ifndef _WIN32
+int             output_dirfd = AT_FDCWD;
+#endif
+
+// OpenOutputDir: Creates the --outdir directory if needed and opens it.
+void OpenOutputDir (char *path)
+{
+    Q_mkdir(path);
+#ifndef _WIN32
+    output_dirfd = open(path, O_RDONLY | O_DIRECTORY);
+    if (output_dirfd < 0)
+        Error("Error opening output directory %s: %s", path, strerror(errno));
+#endif
+}
+
+#ifdef _WIN32
+// OutputPath: The --outdir path joined to name, or NULL (with errno set) if it
+// does not fit.
+const char *OutputPath (const char *name, char *path, size_t size)
+{
+    if (!output_dir)
+        return name;
+    if (snprintf(path, size, "%s/%s", output_dir, name) >= (int)size) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return path;
+}
+#endif
+
+// OpenOutput: fopen for an output name, with mode "rb", "r" or "wb". Returns NULL
+// with errno set on failure.
+FILE *OpenOutput (const char *name, const char *mode)
+{
+#ifdef _WIN32
+    char path[2048];
+    const char *p = OutputPath(name, path, sizeof(path));
+    return p ? fopen(p, mode) : NULL;
+#else
+    int fd = openat(output_dirfd, name, mode[0] == 'w' ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY, 0666);
+    if (fd < 0)
+        return NULL;
+    FILE *f = fdopen(fd, mode);
+    if (!f) {
+        int e = errno;
+        close(fd);
+        errno = e;
+    }
+    return f;
+#endif
+}
+
+// SafeOpenOutput: OpenOutput for writing that raises an error on failure.
+FILE *SafeOpenOutput (const char *name)
+{
+    FILE *f = OpenOutput(name, "wb");
+    if (!f)
+        Error("Error opening %s for write: %s", name, strerror(errno));
+    return f;
+}
+
+// StatOutput: stat for an output name.
+int StatOutput (const char *name, struct stat *st)
+{
+#ifdef _WIN32
+    char path[2048];
+    const char *p = OutputPath(name, path, sizeof(path));
+    return p ? stat(p, st) : -1;
+#else
+    return fstatat(output_dirfd, name, st, 0);
+#endif
+}
+
+// RenameOutput: rename for two output names.
+int RenameOutput (const char *from, const char *to)
+{
+#ifdef _WIN32
+    char frompath[2048], topath[2048];
+    const char *f = OutputPath(from, frompath, sizeof(frompath)), *t = OutputPath(to, topath, sizeof(topath));
+    if (!f || !t)
+        return -1;
+    remove(t);  // rename does not replace an existing file on Windows
+    return rename(f, t);
+#else
+    return renameat(output_dirfd, from, output_dirfd, to);
+#endif
+}
+
+// MakeOutputDir: Creates a directory inside the output directory; one that
+// already exists is not an error.
+void MakeOutputDir (const char *name)
+{
+#ifdef _WIN32
+    char path[2048];
+    const char *p = OutputPath(name, path, sizeof(path));
+    if (p && _mkdir(p) != -1)
+        return;
+#else
+    if (mkdirat(output_dirfd, name, 0777) != -1)
+        return;
+#endif
+    if (errno != EEXIST)
+        Error("mkdir %s: %s", name, strerror(errno));
+}
+
+// --- Arena Allocator ---
+// Per-worker bump allocators. An arena is sized once per model from the header
+// (ArenaReserve) and then hands out frame and skin buffers without touching the
+// heap; ArenaReset rewinds it for the next frame. A request that does not fit is
+// served from an overflow block, and the arena grows to its high-water mark the
+// next time it is reserved, so later models convert with zero allocations.
+//
+// With --max-memory, every arena, read file image and queued output copy of a
+// worker is charged to a counter of the worker's, and a charge that would take it past the ceiling is an
+// error for that model before anything is allocated. Sizes from a hostile header
+// therefore fail cleanly instead of reaching malloc.
+int heap_allocations; // Every heap (re)allocation made for conversion buffers
+size_t max_memory;    // --max-memory: bytes one worker may hold, 0 for no limit
+
+void *CountedRealloc (void *ptr, size_t size)
+{
+    __sync_fetch_and_add(&heap_allocations, 1);
+    return realloc(ptr, size);
+}
+
+// TryChargeMemory: Adds bytes to a worker's memory counter (NULL for memory that
+// is not counted). Returns false, charging nothing, if that would exceed
+// --max-memory. Frame and writer threads update the same counter concurrently.
+qboolean TryChargeMemory (size_t *memory, size_t bytes)
+{
+    if (!memory || !bytes)
+        return true;
+    size_t total = __sync_add_and_fetch(memory, bytes);
+    if (max_memory && (total > max_memory || total < bytes)) {
+        __sync_fetch_and_sub(memory, bytes);
+        return false;
+    }
+    return true;
+}
+
+// ChargeMemory: TryChargeMemory that fails the model.
+void ChargeMemory (size_t *memory, size_t bytes, const char *what)
+{
+    if (!TryChargeMemory(memory, bytes))
+        Error("%s needs %zu more bytes; the worker already holds %zu of --max-memory %zu.",
+              what, bytes, *memory, max_memory);
+}
+
+// ReleaseMemory: Takes bytes back off a worker's memory counter.
+void ReleaseMemory (size_t *memory, size_t bytes)
+{
+    if (memory && bytes)
+        __sync_fetch_and_sub(memory, bytes);
+}
+
+#define ARENA_ALIGN         16
+#define ArenaRound(size)    (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct arenablock_s {
+    struct arenablock_s *next;
+} arenablock_t; // Overflow block header; the payload starts ARENA_ALIGN bytes in
+
+typedef struct {
+    byte            *base;
+    size_t          size;
+    size_t          used;
+    size_t          overflowed;     // Bytes handed out from overflow blocks
+    size_t          highwater;      // Largest total demand since the last reserve
+    arenablock_t    *overflow;
+    int             allocations;    // Heap allocations made by this arena
+    size_t          *memory;        // Worker memory counter the arena is charged to, or NULL
+} arena_t;
 
-// ReadLittleLong: Reads a 4-byte integer from a file and converts to host byte order.
-int ReadLittleLong(FILE* f) {
-    unsigned char b[4];
-    SafeRead(f, b, 4);
-    return (int)(b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24));
+// ArenaReset: Rewinds the arena and releases any overflow blocks.
+void ArenaReset (arena_t *a)
+{
+    while (a->overflow) {
+        arenablock_t *next = a->overflow->next;
+        free(a->overflow);
+        a->overflow = next;
+    }
+    ReleaseMemory(a->memory, a->overflowed);
+    a->used = 0;
+    a->overflowed = 0;
 }
 
-// ReadBigLong: Reads a 4-byte integer from a file and converts from Big-Endian to host byte order.
-// This is used for specific fields that are Big-Endian in the MDL, like group counts.
-int ReadBigLong(FILE* f) {
-    unsigned char b[4];
-    SafeRead(f, b, 4);
-    return (int)(b[3] | (b[2] << 8) | (b[1] << 16) | (b[0] << 24));
+// ArenaReserve: Rewinds the arena and makes sure one contiguous block can hold
+// size bytes (and at least as much as was ever demanded of it before).
+void ArenaReserve (arena_t *a, size_t size)
+{
+    ArenaReset(a);
+    if (size < a->highwater)
+        size = a->highwater;
+    if (size > a->size) {
+        ChargeMemory(a->memory, size - a->size, "Arena");
+        byte *base = (byte *)CountedRealloc(a->base, size);
+        if (!base) {
+            ReleaseMemory(a->memory, size - a->size);
+            Error("Failed to allocate %zu bytes of arena memory.", size);
+        }
+        a->allocations++;
+        a->base = base;
+        a->size = size;
+    }
+    a->highwater = 0;
 }
 
-// BigLongToHost: Converts a 4-byte integer from Big-Endian to host byte order (in-memory).
-// This function is still useful for other Big-Endian values that might be read into a struct directly.
-int BigLongToHost(int bigEndianVal) {
-    unsigned char b[4];
-    memcpy(b, &bigEndianVal, 4);
-    return (int)(b[3] | (b[2] << 8) | (b[1] << 16) | (b[0] << 24));
+// ArenaAlloc: Returns ARENA_ALIGN-aligned memory that stays valid until the next
+// ArenaReset or ArenaReserve.
+void *ArenaAlloc (arena_t *a, size_t size)
+{
+    if (size > SIZE_MAX - ARENA_ALIGN * 2)
+        Error("Arena request of %zu bytes is too large.", size);
+    size = ArenaRound(size);
+    if (size <= a->size - a->used) {
+        void *p = a->base + a->used;
+        a->used += size;
+        if (a->used + a->overflowed > a->highwater)
+            a->highwater = a->used + a->overflowed;
+        return p;
+    }
+
+    ChargeMemory(a->memory, size, "Arena overflow");
+    arenablock_t *block = (arenablock_t *)CountedRealloc(NULL, ARENA_ALIGN + size);
+    if (!block) {
+        ReleaseMemory(a->memory, size);
+        Error("Failed to allocate %zu bytes of arena memory.", size);
+    }
+    a->allocations++;
+    block->next = a->overflow;
+    a->overflow = block;
+    a->overflowed += size;
+    if (a->used + a->overflowed > a->highwater)
+        a->highwater = a->used + a->overflowed;
+    return (byte *)block + ARENA_ALIGN;
 }
 
-// ReadLittleFloat: Reads a 4-byte float from a file and converts to host byte order.
-float ReadLittleFloat(FILE* f) {
-    union { unsigned char b[4]; float f; } val;
-    SafeRead(f, val.b, 4);
-    return val.f;
+// FreeArena: Releases the arena's memory; it stays charged to the same counter.
+void FreeArena (arena_t *a)
+{
+    size_t *memory = a->memory;
+    ArenaReset(a);
+    free(a->base);
+    ReleaseMemory(memory, a->size);
+    memset(a, 0, sizeof(*a));
+    a->memory = memory;
 }
 
+// --- Byte Order Conversion Functions ---
+// MDL files are Little-Endian. LBM and .tri files are Big-Endian. Arrays are
+// converted in bulk with libmdl's MDL_LittleLongs and MDL_BigLongs, which know
+// the host's byte order; single header fields are written byte by byte below,
+// which works on any host.
+
 // WriteBigShortToBuffer: Writes a 2-byte short to a buffer in Big-Endian format.
 void WriteBigShortToBuffer(byte* buffer, unsigned short val) {
     buffer[0] = (byte)((val >> 8) & 0xFF);
@@ -136,129 +416,201 @@ void WriteBigLongToBuffer(byte* buffer, unsigned int val) {
     buffer[3] = (byte)(val & 0xFF);
 }
 
-// WriteBigFloat: Writes a 4-byte float to a file in Big-Endian format.
-void WriteBigFloat(FILE* f, float val) {
-    union { unsigned char b[4]; float f; } in;
-    in.f = val;
-    
-    // Swap bytes for Big-Endian
-    unsigned char b_swapped[4];
-    b_swapped[0] = in.b[3];
-    b_swapped[1] = in.b[2];
-    b_swapped[2] = in.b[1];
-    b_swapped[3] = in.b[0];
 
-    SafeWrite(f, b_swapped, 4);
-}
+#define IDTRIHEADER     123322 // Correct magic number for Alias .tri files
+
+// trilib.h structures for output .tri files
+// .tri files contain the number of triangles followed by 3 alias points for each
+// triangle. A triangle soup of tf_triangle is laid out exactly as the file body.
+typedef struct {
+	vec3_t	n;    // normal
+	vec3_t	p;    // point
+	vec3_t	c;    // color
+	float	u;
+	float	v;
+} aliaspoint_t;
 
+typedef struct {
+	aliaspoint_t	pt[3];
+} tf_triangle;
 
-// --- Math Helper Functions (Simplified from Quake's mathlib.h) ---
-void VectorCopy(vec3_t in, vec3_t out) {
-    out[0] = in[0]; out[1] = in[1]; out[2] = in[2];
-}
+// --- Memory-Mapped MDL Input ---
+// The whole .mdl is mapped (or, where mmap is unavailable or fails, read with a
+// single fread) and libmdl parses that image in place. stvert_t, dtriangle_t,
+// daliasframe_t and trivertx_t arrays are used where they lie, so no per-field
+// libc calls or copies are needed while walking the file.
+//
+// --watch reads files instead, into a buffer each worker keeps: a model can be
+// saved again, or truncated by a slow editor, while it is being converted, and a
+// file that shrinks under a map raises SIGBUS on the next read past its new end,
+// which would kill the daemon. A read that is cut short fails just that model,
+// and the save that finishes the file converts it again.
+qboolean read_input;    // Read files into the kept buffer rather than map them (--watch)
 
-void VectorSubtract(vec3_t va, vec3_t vb, vec3_t vc) {
-    vc[0] = va[0] - vb[0]; vc[1] = va[1] - vb[1]; vc[2] = va[2] - vb[2];
-}
+typedef struct {
+    byte    *data;      // Start of the file image
+    size_t  size;       // Size of the file image in bytes
+    int     mapped;     // 1 if data is an mmap view, 0 if it was malloc'd
+    char    *filename;  // For error messages
+    size_t  *memory;    // Worker memory counter a read image is charged to, or NULL
+    size_t  charged;    // Bytes charged for it
+    byte    *buffer;    // With read_input, the read buffer kept from file to file
+    size_t  buffersize; // Its size, charged to memory while it is kept
+} mdlfile_t;
 
-void CrossProduct(vec3_t v1, vec3_t v2, vec3_t cross) {
-    cross[0] = v1[1] * v2[2] - v1[2] * v2[1];
-    cross[1] = v1[2] * v2[0] - v1[0] * v2[2];
-    cross[2] = v1[0] * v2[1] - v1[1] * v2[0];
+// ReadStdin: Reads all of stdin in one forward pass. Nothing in an MDL needs to
+// be sought back to, so the model can come straight out of a pipe.
+void ReadStdin (mdlfile_t *mf)
+{
+    size_t size = 0;
+    for (;;) {
+        if (mf->size == size) {
+            if (max_memory && size >= max_memory)
+                Error("<stdin> is larger than --max-memory (%zu bytes).", max_memory);
+            size = size ? size * 2 : 65536;
+            if (max_memory && size > max_memory)
+                size = max_memory;
+            ChargeMemory(mf->memory, size - mf->charged, "<stdin>");
+            byte *data = (byte *)CountedRealloc(mf->data, size);
+            if (!data) {
+                ReleaseMemory(mf->memory, size - mf->charged);
+                Error("Failed to allocate %zu bytes for stdin.", size);
+            }
+            mf->data = data;
+            mf->charged = size;
+        }
+        size_t n = fread(mf->data + mf->size, 1, size - mf->size, stdin);
+        mf->size += n;
+        if (n == 0) {
+            if (ferror(stdin))
+                Error("Error reading stdin: %s", strerror(errno));
+            break;
+        }
+    }
 }
 
-float VectorLength(vec3_t v) {
-    return sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]); // Using sqrtf for float
+// ReadMDLFile: Reads a whole file into the kept buffer, growing it as needed. The
+// file is closed again before any error, so a failed model leaks no descriptor.
+void ReadMDLFile (char *filename, mdlfile_t *mf)
+{
+    FILE *f = SafeOpenRead(filename);
+    int length = filelength(f);
+    if (length < 0) {
+        fclose(f);
+        Error ("Could not determine the size of %s, or it is over 2 GB", filename);
+    }
+    size_t size = length > 0 ? (size_t)length : 1;
+    if (size > mf->buffersize) {
+        if (!TryChargeMemory(mf->memory, size - mf->buffersize)) {
+            fclose(f);
+            Error ("%s is %d bytes; the worker already holds %zu of --max-memory %zu.",
+                   filename, length, *mf->memory, max_memory);
+        }
+        byte *buffer = (byte *)CountedRealloc(mf->buffer, size);
+        if (!buffer) {
+            ReleaseMemory(mf->memory, size - mf->buffersize);
+            fclose(f);
+            Error ("Failed to allocate %d bytes for %s", length, filename);
+        }
+        mf->buffer = buffer;
+        mf->buffersize = size;
+    }
+    size_t n = fread(mf->buffer, 1, (size_t)length, f);
+    fclose(f);
+    if (n != (size_t)length)
+        Error ("%s changed while it was read: expected %d bytes, read %zu.", filename, length, n);
+    mf->data = mf->buffer;
+    mf->size = n;
 }
 
-void VectorNormalize(vec3_t v) {
-    float length = VectorLength(v);
-    if (length == 0) {
-        v[0] = v[1] = v[2] = 0;
+// LoadMDLFile: Maps (or reads) an entire file into memory. "-" reads stdin. A read
+// image is charged to memory (NULL for none); a mapped one is backed by the file.
+// With read_input, the file goes into mf's kept buffer instead.
+void LoadMDLFile (char *filename, mdlfile_t *mf, size_t *memory)
+{
+    byte *buffer = mf->buffer;
+    size_t buffersize = mf->buffersize;
+    memset(mf, 0, sizeof(*mf));
+    mf->filename = filename;
+    mf->memory = memory;
+    mf->buffer = buffer;
+    mf->buffersize = buffersize;
+
+    if (!strcmp(filename, "-")) {
+        mf->filename = "<stdin>";
+        ReadStdin(mf);
         return;
     }
-    v[0] /= length; v[1] /= length; v[2] /= length;
-}
 
-float DotProduct(vec3_t v1, vec3_t v2) {
-    return v1[0]*v2[0] + v1[1]*v2[1] + v1[2]*v2[2];
-}
+    if (read_input) {
+        ReadMDLFile(filename, mf);
+        return;
+    }
 
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+        Error ("Error opening %s for read: %s", filename, strerror(errno));
 
-// --- Structures from modelgen.h, adapted for reading ---
-#define ALIAS_VERSION	6
-#define IDPOLYHEADER	(('O'<<24)+('P'<<16)+('D'<<8)+'I') // Little-endian "IDPO"
-#define IDTRIHEADER     123322 // Correct magic number for Alias .tri files
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+            mf->data = (byte *)view;
+            mf->size = (size_t)st.st_size;
+            mf->mapped = 1;
+            close(fd);
+            return;
+        }
+    }
+    close(fd);
+#endif
 
+    // Fallback: one full read into a single buffer
+    FILE *f = SafeOpenRead(filename);
+    int length = filelength(f);
+    if (length < 0)
+        Error ("Could not determine the size of %s, or it is over 2 GB", filename);
+    ChargeMemory(mf->memory, length > 0 ? length : 1, filename);
+    mf->charged = length > 0 ? length : 1;
+    mf->data = (byte *)malloc(mf->charged);
+    if (!mf->data) {
+        ReleaseMemory(mf->memory, mf->charged);
+        mf->charged = 0;
+        Error ("Failed to allocate %d bytes for %s", length, filename);
+    }
+    SafeRead(f, mf->data, length);
+    fclose(f);
+    mf->size = (size_t)length;
+}
 
-typedef enum {ST_SYNC=0, ST_RAND } synctype_t;
-typedef enum { ALIAS_SINGLE=0, ALIAS_GROUP } aliasframetype_t;
-typedef enum { ALIAS_SKIN_SINGLE=0, ALIAS_SKIN_GROUP } aliasskintype_t; // Original struct uses an anonymous union for type
-
-// MDL Header structure
-typedef struct {
-	int			ident;
-	int			version;
-	vec3_t		scale;          // Model scale factor for vertex coordinates
-	vec3_t		scale_origin;   // Origin for scaling vertex coordinates
-	float		boundingradius;
-	vec3_t		eyeposition;
-	int			numskins;       // Number of skins
-	int			skinwidth;      // Width of the skin texture
-	int			skinheight;     // Height of the skin texture
-	int			numverts;       // Number of vertices
-	int			numtris;        // Number of triangles
-	int			numframes;      // Number of frames
-	synctype_t	synctype;
-	int			flags;
-	float		size;
-} mdl_header_t;
-
-// ST vertex structure (for texture coordinates)
-typedef struct {
-	int		onseam;
-	int		s;
-	int		t;
-} stvert_t;
-
-// Triangle structure (indices to vertices)
-typedef struct {
-	int					facesfront;
-	int					vertindex[3]; // Indices into the vertex list
-} dtriangle_t;
-
-// Raw vertex data in MDL frames (byte-packed)
-typedef struct {
-	byte	v[3]; // X, Y, Z coordinates packed as bytes
-	byte	lightnormalindex; // Index into a predefined normal lookup table
-} trivertx_t;
-
-// Single animation frame header
-// Using __attribute__((packed)) to prevent compiler padding
-typedef struct __attribute__((packed)) {
-	trivertx_t	bboxmin;
-	trivertx_t	bboxmax;
-	char		name[16]; // Frame name
-} daliasframe_t;
-
-// Animation frame group header
-// Using __attribute__((packed)) to prevent compiler padding
-typedef struct __attribute__((packed)) {
-	int			numframes; // Placeholder value in original modelgen.c (often 0)
-	trivertx_t	bboxmin;
-	trivertx_t	bboxmax;
-} daliasgroup_t;
-
-// Dummy trilib.h structures for output .tri files
-// .tri files typically contain the number of triangles followed by vertex data for each triangle.
-typedef struct {
-	vec3_t	verts[3]; // 3 vertices, each with 3 float coordinates (X, Y, Z)
-} triangle_t;
+// FreeMDLFile: Releases the file image. A kept read buffer stays for the next file.
+void FreeMDLFile (mdlfile_t *mf)
+{
+    if (mf->data && mf->data == mf->buffer) {
+        mf->data = NULL;
+        return;
+    }
+#ifndef _WIN32
+    if (mf->mapped) {
+        munmap(mf->data, mf->size);
+        mf->data = NULL;
+        return;
+    }
+#endif
+    free(mf->data);
+    mf->data = NULL;
+    ReleaseMemory(mf->memory, mf->charged);
+    mf->charged = 0;
+}
 
 // --- FUNCTION PROTOTYPES ---
 // These are declared here so the compiler knows their signatures before they are defined.
-void WriteLBMfile (char *filename, byte *data, int width, int height, byte *palette);
-void WriteTriFile(char *filename, triangle_t *triangles, int num_triangles);
+size_t BuildLBMfile (byte *lbm_buffer, const byte *data, int width, int height, byte *palette, qboolean compress);
+size_t LBMFileSize (int width, int height);
+size_t BuildTriFile (byte *buffer, const tf_triangle *triangles, int num_triangles);
+size_t TriFileSize (int num_triangles);
 
 
 // --- LBM Structures and Functions from lbmlib.h and lbmlib.c ---
@@ -290,25 +642,101 @@ typedef struct
 } bmhd_t; // Bitmap Header struct for LBM
 
 
-// WriteLBMfile: Writes an LBM image to disk.
+// --- ByteRun1 (PackBits) Compression ---
+// Each row is encoded on its own, as the LBM readers expect. A control byte n in
+// 0..127 is followed by n+1 literal bytes; n in -127..-1 repeats the next byte
+// 1-n times. Runs of 3 or more become repeats; everything else goes out as
+// literals. Run and run-start detection compare 16 pixels at a time with SSE2.
+
+// RunLength: Number of bytes equal to p[0] at the start of p (1..128, at most len).
+int RunLength (const byte *p, int len)
+{
+    int max = len < 128 ? len : 128;
+    int n = 1;
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8((char)p[0]);
+    for ( ; n + 16 <= max; n += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + n)), first));
+        if (mask != 0xffff)
+            return n + __builtin_ctz(~mask);
+    }
+#endif
+    while (n < max && p[n] == p[0])
+        n++;
+    return n;
+}
+
+// LiteralLength: Number of bytes at p (1..128, at most len) before the next run of
+// 3 identical bytes starts.
+int LiteralLength (const byte *p, int len)
+{
+    int max = len < 128 ? len : 128;
+    int n = 1;
+#if defined(__SSE2__)
+    for ( ; n + 16 <= max && n + 18 <= len; n += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + n));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + n + 1));
+        __m128i c = _mm_loadu_si128((const __m128i *)(p + n + 2));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(b, c)));
+        if (mask)
+            return n + __builtin_ctz(mask);
+    }
+#endif
+    for ( ; n < max; n++) {
+        if (n + 2 < len && p[n] == p[n + 1] && p[n] == p[n + 2])
+            break;
+    }
+    return n;
+}
+
+// PackBitsRow: Compresses len bytes into out (at most len + (len + 127) / 128
+// bytes) and returns the compressed size.
+size_t PackBitsRow (const byte *in, int len, byte *out)
+{
+    byte *start = out;
+    int pos = 0;
+    while (pos < len) {
+        int run = RunLength(in + pos, len - pos);
+        if (run >= 3) {
+            *out++ = (byte)(1 - run);
+            *out++ = in[pos];
+            pos += run;
+        } else {
+            int literal = LiteralLength(in + pos, len - pos);
+            *out++ = (byte)(literal - 1);
+            memcpy(out, in + pos, literal);
+            out += literal;
+            pos += literal;
+        }
+    }
+    return out - start;
+}
+
+
+// LBMFileSize: Upper bound on the size of the LBM file BuildLBMfile produces.
+// LBM structure:
+// FORM chunk (12 bytes: "FORM" + 4-byte length + "PBM ")
+// BMHD chunk (8 bytes: "BMHD" + 4-byte length + sizeof(bmhd_t) = 20 bytes + optional 1-byte padding)
+// CMAP chunk (8 bytes: "CMAP" + 4-byte length + 768 bytes palette data + optional 1-byte padding)
+// BODY chunk (8 bytes: "BODY" + 4-byte length + pixel data + optional 1-byte padding)
+// The pixel data is width*height bytes, or for ByteRun1 at most one control byte
+// more per 128 pixels of each row.
+size_t LBMFileSize (int width, int height)
+{
+    size_t body = (size_t)height * ((size_t)width + ((size_t)width + 127) / 128);
+    return 12 + (8 + sizeof(bmhd_t) + 1) + (8 + 768 + 1) + (8 + body + 1);
+}
+
+// BuildLBMfile: Builds an LBM image in lbm_buffer (LBMFileSize bytes) and
+// returns its length.
 // This implementation creates a simple PBM (Packed Bitmap) type LBM,
-// which is uncompressed and 8-bit paletted.
-void WriteLBMfile (char *filename, byte *data, int width, int height, byte *palette)
+// which is 8-bit paletted and either uncompressed or ByteRun1 compressed.
+size_t BuildLBMfile (byte *lbm_buffer, const byte *data, int width, int height, byte *palette, qboolean compress)
 {
-    byte    *lbm_buffer, *lbmptr;
+    byte    *lbmptr;
     unsigned int form_len, bmhd_len, cmap_len, body_len;
 
-    // Allocate enough memory for the LBM file.
-    // LBM structure:
-    // FORM chunk (8 bytes: "FORM" + 4-byte length + "PBM ")
-    // BMHD chunk (8 bytes: "BMHD" + 4-byte length + sizeof(bmhd_t) = 20 bytes + optional 1-byte padding)
-    // CMAP chunk (8 bytes: "CMAP" + 4-byte length + 768 bytes palette data + optional 1-byte padding)
-    // BODY chunk (8 bytes: "BODY" + 4-byte length + width*height pixel data + optional 1-byte padding)
-    // Total max size: 8 + (8+20+1) + (8+768+1) + (8 + 512*512 + 1) // Max skin size is typically 256x256 or 512x256, use 512x512 for safety
-    lbm_buffer = lbmptr = (byte *)malloc(8 + (8 + sizeof(bmhd_t) + 1) + (8 + 768 + 1) + (8 + 512*512 + 1)); // Increased size for larger possible skins
-    if (!lbm_buffer) {
-        Error("Failed to allocate memory for LBM file buffer.");
-    }
+    lbmptr = lbm_buffer;
 
     // FORM chunk header
     memcpy(lbmptr, "FORM", 4); lbmptr += 4;
@@ -327,7 +755,7 @@ void WriteLBMfile (char *filename, byte *data, int width, int height, byte *pale
     basebmhd.y = (WORD)0;
     basebmhd.nPlanes = (UBYTE)8; // 8 bitplanes for 256 colors
     basebmhd.masking = (UBYTE)ms_none; // No mask
-    basebmhd.compression = (UBYTE)cm_none; // No compression
+    basebmhd.compression = (UBYTE)(compress ? cm_rle1 : cm_none);
     basebmhd.transparentColor = (UWORD)0; // No transparency
     basebmhd.xAspect = (UBYTE)5; // Default aspect ratio
     basebmhd.yAspect = (UBYTE)6;
@@ -365,7 +793,12 @@ void WriteLBMfile (char *filename, byte *data, int width, int height, byte *pale
     // BODY chunk
     memcpy(lbmptr, "BODY", 4); lbmptr += 4;
     byte *body_len_ptr = lbmptr; lbmptr += 4; // Placeholder for BODY length
-    memcpy(lbmptr, data, width * height); lbmptr += (width * height); // Copy raw pixel data
+    if (compress) {
+        for (int y = 0; y < height; y++)
+            lbmptr += PackBitsRow(data + (size_t)y * width, width, lbmptr);
+    } else {
+        memcpy(lbmptr, data, (size_t)width * height); lbmptr += ((size_t)width * height); // Copy raw pixel data
+    }
     body_len = (lbmptr - (body_len_ptr + 4));
     WriteBigLongToBuffer(body_len_ptr, body_len);
     if (body_len & 1) *lbmptr++ = 0; // Pad if odd length
@@ -374,355 +807,4405 @@ void WriteLBMfile (char *filename, byte *data, int width, int height, byte *pale
     form_len = (lbmptr - (form_len_ptr + 4));
     WriteBigLongToBuffer(form_len_ptr, form_len);
 
-    // Write the entire buffered LBM data to output file
-    SaveFile (filename, lbm_buffer, lbmptr-lbm_buffer);
-    free (lbm_buffer);
+    return lbmptr - lbm_buffer;
+}
+
+
+// --- True-Color Skins ---
+// --skin-format=tga or rgba expands the palette indices to 32-bit pixels in the
+// same pass that reads them from the file image, so textures need no second
+// conversion. The expansion is a lookup in a table of packed pixels; on x86 that
+// beats splitting the palette into 16-entry pshufb slices (16 lookups per
+// channel) by about 3x. AArch64 looks 64 entries up per vqtbl4q, so there the
+// palette is looked up in channel planes and vst4q interleaves the pixels.
+// --fullbright also writes <base>_skin<i>_luma: the pixels with indices 224-255,
+// which Quake draws unlit, over transparent black. Skins without fullbright
+// pixels get no mask.
+#define FULLBRIGHT_START    224
+#define TGA_HEADER_SIZE     18
+
+typedef enum { SKIN_LBM, SKIN_TGA, SKIN_RGBA } skinformat_t;
+
+skinformat_t    skin_format = SKIN_LBM; // --skin-format
+qboolean        output_fullbright;      // --fullbright
+
+typedef struct {
+    byte    pixels[256][4];                         // Packed pixels, in output channel order
+    byte    planes[4][256] __attribute__((aligned(16))); // The same, one plane per channel
+} skinpalette_t;
+
+skinpalette_t skin_palette;
+const char *skin_extensions[] = { "lbm", "tga", "rgba" };
+
+// BuildSkinPalette: Lays a 768-byte RGB palette out for expansion. TGA stores
+// pixels as BGRA, raw output as RGBA. Every entry is opaque.
+void BuildSkinPalette (skinpalette_t *sp, const byte *palette, qboolean bgra)
+{
+    for (int i = 0; i < 256; i++) {
+        const byte *rgb = palette + i * 3;
+        sp->pixels[i][0] = bgra ? rgb[2] : rgb[0];
+        sp->pixels[i][1] = rgb[1];
+        sp->pixels[i][2] = bgra ? rgb[0] : rgb[2];
+        sp->pixels[i][3] = 255;
+    }
+    // A separate pass: with the plane stores fused into the loop above, gcc 12.2
+    // -O2 (ivopts after loop vectorization) addresses the pixel store from a null
+    // base, local-pure-const takes that for a null dereference and marks this
+    // function pure, and main's call is deleted, leaving an all-zero table. The
+    // code is valid C; -fno-ivopts or this split avoids the miscompile.
+    for (int c = 0; c < 4; c++) {
+        for (int i = 0; i < 256; i++)
+            sp->planes[c][i] = sp->pixels[i][c];
+    }
+}
+
+// ExpandPixels: Writes the 4-byte pixel of each of count indices to out and, if
+// luma is not NULL, the fullbright mask to luma. Returns the number of
+// fullbright pixels (0 when luma is NULL).
+int ExpandPixels (const skinpalette_t *sp, const byte *in, int count, byte *out, byte *luma)
+{
+    int i = 0;
+    int fullbright = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16x4_t planes[3][4];
+    for (int c = 0; c < 3; c++) {
+        for (int t = 0; t < 4; t++) {
+            for (int k = 0; k < 4; k++)
+                planes[c][t].val[k] = vld1q_u8(&sp->planes[c][t * 64 + k * 16]);
+        }
+    }
+    const uint8x16_t step = vdupq_n_u8(64), start = vdupq_n_u8(FULLBRIGHT_START);
+    for ( ; i + 16 <= count; i += 16) {
+        uint8x16_t idx = vld1q_u8(in + i);
+        uint8x16x4_t px;
+        for (int c = 0; c < 3; c++) {
+            // vqtbx4q leaves lanes whose index is out of its 64 entries alone
+            uint8x16_t j = idx;
+            uint8x16_t v = vqtbl4q_u8(planes[c][0], j);
+            j = vsubq_u8(j, step);
+            v = vqtbx4q_u8(v, planes[c][1], j);
+            j = vsubq_u8(j, step);
+            v = vqtbx4q_u8(v, planes[c][2], j);
+            j = vsubq_u8(j, step);
+            px.val[c] = vqtbx4q_u8(v, planes[c][3], j);
+        }
+        px.val[3] = vdupq_n_u8(255);
+        vst4q_u8(out + (size_t)i * 4, px);
+        if (luma) {
+            uint8x16_t mask = vcgeq_u8(idx, start);
+            for (int c = 0; c < 4; c++)
+                px.val[c] = vandq_u8(px.val[c], mask);
+            vst4q_u8(luma + (size_t)i * 4, px);
+            fullbright += vaddvq_u8(vshrq_n_u8(mask, 7));
+        }
+    }
+#endif
+    for ( ; i < count; i++) {
+        memcpy(out + (size_t)i * 4, sp->pixels[in[i]], 4);
+        if (luma) {
+            if (in[i] >= FULLBRIGHT_START) {
+                memcpy(luma + (size_t)i * 4, sp->pixels[in[i]], 4);
+                fullbright++;
+            } else {
+                memset(luma + (size_t)i * 4, 0, 4);
+            }
+        }
+    }
+    return fullbright;
+}
+
+// TrueColorFileSize: Size of a .tga (header and 32-bit pixels) or raw .rgba skin.
+size_t TrueColorFileSize (int width, int height)
+{
+    return (skin_format == SKIN_TGA ? TGA_HEADER_SIZE : 0) + (size_t)width * height * 4;
+}
+
+// WriteTGAHeader: Uncompressed true-color (type 2), 32 bits with 8 alpha bits,
+// rows stored top to bottom as in the skin.
+void WriteTGAHeader (byte *p, int width, int height)
+{
+    memset(p, 0, TGA_HEADER_SIZE);
+    p[2] = 2;
+    p[12] = (byte)(width & 0xff);
+    p[13] = (byte)(width >> 8);
+    p[14] = (byte)(height & 0xff);
+    p[15] = (byte)(height >> 8);
+    p[16] = 32;
+    p[17] = 0x28;   // Top-left origin, 8 alpha bits
+}
+
+// BuildTrueColorFile: Builds a skin in buffer and, if luma is not NULL, its
+// fullbright mask in luma (both TrueColorFileSize bytes). Returns the length;
+// *fullbright is the number of fullbright pixels.
+size_t BuildTrueColorFile (byte *buffer, byte *luma, const byte *data, int width, int height, int *fullbright)
+{
+    size_t header = 0;
+    if (skin_format == SKIN_TGA) {
+        if (width > 65535 || height > 65535)
+            Error("Skin size %dx%d is too large for TGA.", width, height);
+        WriteTGAHeader(buffer, width, height);
+        if (luma)
+            WriteTGAHeader(luma, width, height);
+        header = TGA_HEADER_SIZE;
+    }
+    *fullbright = ExpandPixels(&skin_palette, data, width * height, buffer + header, luma ? luma + header : NULL);
+    return header + (size_t)width * height * 4;
+}
+
+// SkinFileSize: Size of one skin output in the chosen format.
+size_t SkinFileSize (int width, int height)
+{
+    return skin_format == SKIN_LBM ? LBMFileSize(width, height) : TrueColorFileSize(width, height);
+}
+
+
+static const char tri_obj_name[] = "exported_object";
+static const char tri_tex_name[] = "default_skin";
+
+// TriFileSize: Size of the .tri file BuildTriFile produces for num_triangles.
+// Header (magic, FLOAT_START, names, count), 3 aliaspoint_t of 11 floats per
+// triangle, then FLOAT_END and the object name.
+size_t TriFileSize (int num_triangles)
+{
+    return 4 + 4 + sizeof(tri_obj_name) + 4 + sizeof(tri_tex_name)
+         + (size_t)num_triangles * 3 * 11 * sizeof(float)
+         + 4 + sizeof(tri_obj_name);
 }
 
+// BuildTriFile: Builds a .tri file in the Alias format compatible with modelgen in
+// buffer (TriFileSize bytes) and returns its length, so it can be saved with a
+// single write: the host-order triangle soup is byte-swapped to Big-Endian in
+// bulk straight into the body.
+size_t BuildTriFile (byte *buffer, const tf_triangle *triangles, int num_triangles) {
+    const char *obj_name = tri_obj_name;
+    const char *tex_name = tri_tex_name;
 
-// WriteTriFile: Writes a .tri file in the Alias format compatible with modelgen.
-void WriteTriFile(char *filename, triangle_t *triangles, int num_triangles) {
-    FILE *f = SafeOpenWrite(filename);
+    size_t body_len = (size_t)num_triangles * sizeof(tf_triangle);
+    byte *p = buffer;
 
     // 1. Write the Magic Number (Big-Endian)
-    unsigned char magic_bytes[4];
-    WriteBigLongToBuffer(magic_bytes, IDTRIHEADER);
-    SafeWrite(f, magic_bytes, 4);
+    WriteBigLongToBuffer(p, IDTRIHEADER); p += 4;
 
     // 2. Write the FLOAT_START marker (Big-Endian float)
-    WriteBigFloat(f, 99999.0f);
+    union { float f; unsigned int i; } marker;
+    marker.f = 99999.0f;
+    WriteBigLongToBuffer(p, marker.i); p += 4;
 
     // 3. Write a dummy object name (null-terminated string)
-    char obj_name[] = "exported_object";
-    SafeWrite(f, obj_name, sizeof(obj_name));
+    memcpy(p, obj_name, sizeof(tri_obj_name)); p += sizeof(tri_obj_name);
 
     // 4. Write the number of triangles (Big-Endian integer)
-    unsigned char count_bytes[4];
-    WriteBigLongToBuffer(count_bytes, num_triangles);
-    SafeWrite(f, count_bytes, 4);
+    WriteBigLongToBuffer(p, num_triangles); p += 4;
 
     // 5. Write a dummy texture name (null-terminated string)
-    char tex_name[] = "default_skin";
-    SafeWrite(f, tex_name, sizeof(tex_name));
-    
+    memcpy(p, tex_name, sizeof(tri_tex_name)); p += sizeof(tri_tex_name);
+
     // 6. Write the triangle data in the full tf_triangle format.
-    // The on-disk structure (aliaspoint_t) includes normals, colors, and UVs,
-    // which we can zero out as we only have the vertex positions.
-    for (int i = 0; i < num_triangles; i++) {
-        for (int j = 0; j < 3; j++) { // Loop through 3 vertices per triangle
-            // For each vertex, write the full "aliaspoint_t" structure.
-            // All values must be Big-Endian floats.
+    // All values must be Big-Endian floats.
+    MDL_BigLongs(p, triangles, body_len / 4);
+    p += body_len;
 
-            // vector n (normal) - 3 floats
-            WriteBigFloat(f, 0.0f); WriteBigFloat(f, 0.0f); WriteBigFloat(f, 0.0f);
-            
-            // vector p (point) - 3 floats
-            WriteBigFloat(f, triangles[i].verts[j][0]);
-            WriteBigFloat(f, triangles[i].verts[j][1]);
-            WriteBigFloat(f, triangles[i].verts[j][2]);
+    // 7. Write the FLOAT_END marker (Big-Endian float)
+    marker.f = -99999.0f;
+    WriteBigLongToBuffer(p, marker.i); p += 4;
 
-            // vector c (color) - 3 floats
-            WriteBigFloat(f, 0.0f); WriteBigFloat(f, 0.0f); WriteBigFloat(f, 0.0f);
+    // 8. Write the dummy object name again, as expected by the trilib reader.
+    memcpy(p, obj_name, sizeof(tri_obj_name)); p += sizeof(tri_obj_name);
 
-            // float u, v (texture coordinates) - 2 floats
-            WriteBigFloat(f, 0.0f);
-            WriteBigFloat(f, 0.0f);
-        }
-    }
+    return p - buffer;
+}
 
-    // 7. Write the FLOAT_END marker (Big-Endian float)
-    WriteBigFloat(f, -99999.0f);
-    
-    // 8. Write the dummy object name again, as expected by the trilib reader.
-    SafeWrite(f, obj_name, sizeof(obj_name));
-    
-    fclose(f);
+
+// --- Threads ---
+// Modeled on the RunThreadsOn dispatcher from the Quake tools: a fixed number of
+// threads pull work indices from a shared counter until it runs out.
+int numthreads = 0;     // 0 = one thread per online CPU
+int framethreads = 1;   // Threads used to decode the frames of one model
+
+typedef struct {
+    int             workcount;
+    int             dispatch;
+    pthread_mutex_t lock;
+    void            (*func)(int threadnum, int work, void *arg);
+    void            *arg;
+} threadwork_t;
+
+typedef struct {
+    threadwork_t    *tw;
+    int             threadnum;
+} threadstart_t;
+
+// GetThreadWork: Returns the next work index, or -1 when all work is handed out.
+int GetThreadWork (threadwork_t *tw)
+{
+    int r;
+    pthread_mutex_lock(&tw->lock);
+    if (tw->dispatch == tw->workcount)
+        r = -1;
+    else
+        r = tw->dispatch++;
+    pthread_mutex_unlock(&tw->lock);
+    return r;
 }
 
+void *ThreadWorkerFunction (void *p)
+{
+    threadstart_t *ts = (threadstart_t *)p;
+    int work;
+    while ((work = GetThreadWork(ts->tw)) != -1)
+        ts->tw->func(ts->threadnum, work, ts->tw->arg);
+    return NULL;
+}
 
-// --- Main Program Logic ---
-int main (int argc, char **argv)
+// DefaultThreadCount: Number of online CPUs, or 1 if it cannot be determined.
+int DefaultThreadCount (void)
 {
-	// Hardcoded Quake Palette (256 colors, RGB)
-    // Values provided by the user in hexadecimal 0xRRGGBB format.
-    byte loaded_palette[768] = {
-        0x00,0x00,0x00, 0x0f,0x0f,0x0f, 0x1f,0x1f,0x1f, 0x2f,0x2f,0x2f, 0x3f,0x3f,0x3f, 0x4b,0x4b,0x4b, 0x5b,0x5b,0x5b, 0x6b,0x6b,0x6b,
-        0x7b,0x7b,0x7b, 0x8b,0x8b,0x8b, 0x9b,0x9b,0x9b, 0xab,0xab,0xab, 0xbb,0xbb,0xbb, 0xcb,0xcb,0xcb, 0xdb,0xdb,0xdb, 0xeb,0xeb,0xeb,
-        0x0f,0x0b,0x07, 0x17,0x0f,0x0b, 0x1f,0x17,0x0b, 0x27,0x1b,0x0f, 0x2f,0x23,0x13, 0x37,0x2b,0x17, 0x3f,0x2f,0x17, 0x4b,0x37,0x1b,
-        0x53,0x3b,0x1b, 0x5b,0x43,0x1f, 0x63,0x4b,0x1f, 0x6b,0x53,0x1f, 0x73,0x57,0x1f, 0x7b,0x5f,0x23, 0x83,0x67,0x23, 0x8f,0x6f,0x23,
-        0x0b,0x0b,0x0f, 0x13,0x13,0x1b, 0x1b,0x1b,0x27, 0x27,0x27,0x33, 0x2f,0x2f,0x3f, 0x37,0x37,0x4b, 0x3f,0x3f,0x57, 0x47,0x47,0x67,
-        0x4f,0x4f,0x73, 0x5b,0x5b,0x7f, 0x63,0x63,0x8b, 0x6b,0x6b,0x97, 0x73,0x73,0xa3, 0x7b,0x7b,0xaf, 0x83,0x83,0xbb, 0x8b,0x8b,0xcb,
-        0x00,0x00,0x00, 0x07,0x07,0x00, 0x0b,0x0b,0x00, 0x13,0x13,0x00, 0x1b,0x1b,0x00, 0x23,0x23,0x00, 0x2b,0x2b,0x07, 0x2f,0x2f,0x07,
-        0x37,0x37,0x07, 0x3f,0x3f,0x07, 0x47,0x47,0x07, 0x4b,0x4b,0x0b, 0x53,0x53,0x0b, 0x5b,0x5b,0x0b, 0x63,0x63,0x0b, 0x6b,0x6b,0x0f,
-        0x07,0x00,0x00, 0x0f,0x00,0x00, 0x17,0x00,0x00, 0x1f,0x00,0x00, 0x27,0x00,0x00, 0x2f,0x00,0x00, 0x37,0x00,0x00, 0x3f,0x00,0x00,
-        0x47,0x00,0x00, 0x4f,0x00,0x00, 0x57,0x00,0x00, 0x5f,0x00,0x00, 0x67,0x00,0x00, 0x6f,0x00,0x00, 0x77,0x00,0x00, 0x7f,0x00,0x00,
-        0x13,0x13,0x00, 0x1b,0x1b,0x00, 0x23,0x23,0x00, 0x2f,0x2b,0x00, 0x37,0x2f,0x00, 0x43,0x37,0x00, 0x4b,0x3b,0x07, 0x57,0x43,0x07,
-        0x5f,0x47,0x07, 0x6b,0x4b,0x0b, 0x77,0x53,0x0f, 0x83,0x57,0x13, 0x8b,0x5b,0x13, 0x97,0x5f,0x1b, 0xa3,0x63,0x1f, 0xaf,0x67,0x23,
-        0x23,0x13,0x07, 0x2f,0x17,0x0b, 0x3b,0x1f,0x0f, 0x4b,0x23,0x13, 0x57,0x2b,0x17, 0x63,0x2f,0x1f, 0x73,0x37,0x23, 0x7f,0x3b,0x2b,
-        0x8f,0x43,0x33, 0x9f,0x4f,0x33, 0xaf,0x63,0x2f, 0xbf,0x77,0x2f, 0xcf,0x8f,0x2b, 0xdf,0xab,0x27, 0xef,0xcb,0x1f, 0xff,0xf3,0x1b,
-        0x0b,0x07,0x00, 0x1b,0x13,0x00, 0x2b,0x23,0x0f, 0x37,0x2b,0x13, 0x47,0x33,0x1b, 0x53,0x37,0x23, 0x63,0x3f,0x2b, 0x6f,0x47,0x33,
-        0x7f,0x53,0x3f, 0x8b,0x5f,0x47, 0x9b,0x6b,0x53, 0xa7,0x7b,0x5f, 0xb7,0x87,0x6b, 0xc3,0x93,0x7b, 0xd3,0xa3,0x8b, 0xe3,0xb3,0x97,
-        0xab,0x8b,0xa3, 0x9f,0x7f,0x97, 0x93,0x73,0x87, 0x8b,0x67,0x7b, 0x7f,0x5b,0x6f, 0x77,0x53,0x63, 0x6b,0x4b,0x57, 0x5f,0x3f,0x4b,
-        0x57,0x37,0x43, 0x4b,0x2f,0x37, 0x43,0x27,0x2f, 0x37,0x1f,0x23, 0x2b,0x17,0x1b, 0x23,0x13,0x13, 0x17,0x0b,0x0b, 0x0f,0x07,0x07,
-        0xbb,0x73,0x9f, 0xaf,0x6b,0x8f, 0xa3,0x5f,0x83, 0x97,0x57,0x77, 0x8b,0x4f,0x6b, 0x7f,0x4b,0x5f, 0x73,0x43,0x53, 0x6b,0x3b,0x4b,
-        0x5f,0x33,0x3f, 0x53,0x2b,0x37, 0x47,0x23,0x2b, 0x3b,0x1f,0x23, 0x2f,0x17,0x1b, 0x23,0x13,0x13, 0x17,0x0b,0x0b, 0x0f,0x07,0x07,
-        0xdb,0xc3,0xbb, 0xcb,0xb3,0xa7, 0xbf,0xa3,0x9b, 0xaf,0x97,0x8b, 0xa3,0x87,0x7b, 0x97,0x7b,0x6f, 0x87,0x6f,0x5f, 0x7b,0x63,0x53,
-        0x6b,0x57,0x47, 0x5f,0x4b,0x3b, 0x53,0x3f,0x33, 0x43,0x33,0x27, 0x37,0x2b,0x1f, 0x27,0x1f,0x17, 0x1b,0x13,0x0f, 0x0f,0x0b,0x07,
-        0x6f,0x83,0x7b, 0x67,0x7b,0x6f, 0x5f,0x73,0x67, 0x57,0x6b,0x5f, 0x4f,0x63,0x57, 0x47,0x5b,0x4f, 0x3f,0x53,0x47, 0x37,0x4b,0x3f,
-        0x2f,0x43,0x37, 0x2b,0x3b,0x2f, 0x23,0x33,0x27, 0x1f,0x2b,0x1f, 0x17,0x23,0x17, 0x0f,0x1b,0x13, 0x0b,0x13,0x0b, 0x07,0x0b,0x07,
-        0xff,0xf3,0x1b, 0xef,0xdf,0x17, 0xdb,0xcb,0x13, 0xcb,0xb7,0x0f, 0xbb,0xa7,0x0f, 0xab,0x97,0x0b, 0x9b,0x83,0x07, 0x8b,0x73,0x07,
-        0x7b,0x63,0x07, 0x6b,0x53,0x00, 0x5b,0x47,0x00, 0x4b,0x37,0x00, 0x3b,0x2b,0x00, 0x2b,0x1f,0x00, 0x1b,0x0f,0x00, 0x0b,0x07,0x00,
-        0x00,0x00,0xff, 0x0b,0x0b,0xef, 0x13,0x13,0xdf, 0x1b,0x1b,0xcf, 0x23,0x23,0xbf, 0x2b,0x2b,0xaf, 0x2f,0x2f,0x9f, 0x2f,0x2f,0x8f,
-        0x2f,0x2f,0x7f, 0x2f,0x2f,0x6f, 0x2f,0x2f,0x5f, 0x2b,0x2b,0x4f, 0x23,0x23,0x3f, 0x1b,0x1b,0x2f, 0x13,0x13,0x1f, 0x0b,0x0b,0x0f,
-        0x2b,0x00,0x00, 0x3b,0x00,0x00, 0x4b,0x07,0x00, 0x5f,0x07,0x00, 0x6f,0x0f,0x00, 0x7f,0x17,0x07, 0x93,0x1f,0x07, 0xa3,0x27,0x0b,
-        0xb7,0x33,0x0f, 0xc3,0x4b,0x1b, 0xcf,0x63,0x2b, 0xdb,0x7f,0x3b, 0xe3,0x97,0x4f, 0xe7,0xab,0x5f, 0xef,0xbf,0x77, 0xf7,0xd3,0x8b,
-        0xa7,0x7b,0x3b, 0xb7,0x9b,0x37, 0xc7,0xc3,0x37, 0xe7,0xe3,0x57, 0x7f,0xbf,0xff, 0xab,0xe7,0xff, 0xd7,0xff,0xff, 0x67,0x00,0x00,
-        0x8b,0x00,0x00, 0xb3,0x00,0x00, 0xd7,0x00,0x00, 0xff,0x00,0x00, 0xff,0xf3,0x93, 0xff,0xf7,0xc7, 0xff,0xff,0xff, 0x9f,0x5b,0x53
-    };
-
-	if (argc != 2) // Now expects only the MDL file as input
-	{
-		fprintf(stderr, "Usage: %s <input_mdl_file>\n", argv[0]);
-		return 1;
-	}
+#if defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0)
+        return (int)n;
+#endif
+    return 1;
+}
 
-    char *input_mdl_filename = argv[1];
-    char out_filename_base[1024];
-    
-    // Determine output base filename (e.g., "model" from "model.mdl")
-    char *dot_pos = strrchr(input_mdl_filename, '.');
-    if (dot_pos) {
-        strncpy(out_filename_base, input_mdl_filename, dot_pos - input_mdl_filename);
-        out_filename_base[dot_pos - input_mdl_filename] = '\0';
+// RunThreadsOn: Calls func once for every work index in [0, workcnt), spread over
+// up to threads threads. threadnum identifies the calling thread (0..threads-1)
+// so func can use per-thread state.
+void RunThreadsOn (int workcnt, int threads, void (*func)(int threadnum, int work, void *arg), void *arg)
+{
+    threadwork_t    tw;
+    pthread_t       handles[256];
+    threadstart_t   starts[256];
+
+    if (threads > workcnt)
+        threads = workcnt;
+    if (threads > 256)
+        threads = 256;
+    if (threads < 1)
+        threads = 1;
+
+    tw.workcount = workcnt;
+    tw.dispatch = 0;
+    tw.func = func;
+    tw.arg = arg;
+    pthread_mutex_init(&tw.lock, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        starts[i].tw = &tw;
+        starts[i].threadnum = i;
+    }
+    if (threads == 1) {
+        ThreadWorkerFunction(&starts[0]);
     } else {
-        strcpy(out_filename_base, input_mdl_filename);
+        // If a thread cannot be created, the ones already running share tw with
+        // this frame, so rather than unwinding past them the calling thread takes
+        // the free thread number and works alongside them until the work runs out
+        int started = 0, err = 0;
+        while (started < threads && (err = pthread_create(&handles[started], NULL, ThreadWorkerFunction, &starts[started])) == 0)
+            started++;
+        if (started < threads) {
+            fprintf(stderr, "pthread_create failed after %d of %d threads: %s; continuing with %d.\n",
+                    started, threads, strerror(err), started + 1);
+            ThreadWorkerFunction(&starts[started]);
+        }
+        for (int i = 0; i < started; i++)
+            pthread_join(handles[i], NULL);
     }
+    pthread_mutex_destroy(&tw.lock);
+}
 
-	FILE *mdl_file = SafeOpenRead(input_mdl_filename);
-	printf("Reading MDL file: %s\n", input_mdl_filename);
 
-    // Print struct sizes for debugging padding issues
-    printf("DEBUG: sizeof(trivertx_t): %zu\n", sizeof(trivertx_t));
-    printf("DEBUG: sizeof(daliasframe_t): %zu\n", sizeof(daliasframe_t));
-    printf("DEBUG: sizeof(daliasgroup_t): %zu\n", sizeof(daliasgroup_t));
+// --- Output Container ---
+// With --container, the outputs of a model are collected into one Quake PAK file
+// (<base>.pak) instead of one file each: a 12-byte header pointing at a directory
+// of 64-byte entries (name, offset, length), followed by the payloads. Entry names
+// are the loose file names without their directory, so the PAK can be read with
+// one open and random access by frame, or unpacked by any PAK tool back into the
+// usual .tri/.lbm layout. Payloads are appended as they are produced (frame
+// threads in any order); the directory is sorted into skin, then frame order, and
+// written at the end.
+#define IDPAKHEADER     (('K'<<24)+('C'<<16)+('A'<<8)+'P') // Little-endian "PACK"
+#define MAX_PAKNAME     56
 
+typedef enum { OUTPUT_SKIN=0, OUTPUT_FRAME, OUTPUT_ANIMATION, OUTPUT_INDEX } outputkind_t;
 
-	mdl_header_t header;
+typedef struct {
+    char    name[MAX_PAKNAME];
+    int     filepos, filelen;
+    int     sortkey;            // (kind, index) so the directory comes out in order
+} pakentry_t;
 
-	// Read MDL header and convert fields from little-endian to host byte order
-	header.ident = ReadLittleLong(mdl_file);
-	header.version = ReadLittleLong(mdl_file);
+typedef struct {
+    FILE            *f;
+    char            filename[1024];
+    int             pos;        // End of the last payload
+    pakentry_t      *dir;
+    int             numentries;
+    int             maxentries;
+    int             allocations;
+    pthread_mutex_t lock;
+} pakfile_t;
 
-    // Validate MDL header
-	if (header.ident != IDPOLYHEADER || header.version != ALIAS_VERSION) {
-		Error("Invalid MDL file: Header ID (0x%X) or Version (%d) mismatch. Expected IDPO (0x%X) and version %d.",
-              header.ident, header.version, IDPOLYHEADER, ALIAS_VERSION);
-	}
+qboolean    output_container;       // --container: frames go into <base>.pak
+qboolean    output_container_skins; // --container-skins: skins go in as well
 
-    // Read remaining header fields
-    for (int i = 0; i < 3; i++) header.scale[i] = ReadLittleFloat(mdl_file);
-    for (int i = 0; i < 3; i++) header.scale_origin[i] = ReadLittleFloat(mdl_file);
-    header.boundingradius = ReadLittleFloat(mdl_file);
-    for (int i = 0; i < 3; i++) header.eyeposition[i] = ReadLittleFloat(mdl_file);
-    header.numskins = ReadLittleLong(mdl_file);
-    header.skinwidth = ReadLittleLong(mdl_file);
-    header.skinheight = ReadLittleLong(mdl_file);
-    header.numverts = ReadLittleLong(mdl_file);
-    header.numtris = ReadLittleLong(mdl_file);
-    header.numframes = ReadLittleLong(mdl_file);
-    header.synctype = (synctype_t)ReadLittleLong(mdl_file);
-    header.flags = ReadLittleLong(mdl_file);
-    header.size = ReadLittleFloat(mdl_file);
-
-    printf("MDL Header Info:\n");
-    printf("  Version: %d\n", header.version);
-    printf("  Skins: %d (%dx%d)\n", header.numskins, header.skinwidth, header.skinheight);
-    printf("  Vertices: %d\n", header.numverts);
-    printf("  Triangles: %d\n", header.numtris);
-    printf("  Frames: %d\n", header.numframes);
-    printf("  Scale: (%.4f, %.4f, %.4f)\n", header.scale[0], header.scale[1], header.scale[2]);
-    printf("  Scale Origin: (%.4f, %.4f, %.4f)\n", header.scale_origin[0], header.scale_origin[1], header.scale_origin[2]);
-
-
-    // --- Extract Skins ---
-    printf("\nExtracting Skins...\n");
-    for (int i = 0; i < header.numskins; i++) {
-        (void)ReadLittleLong(mdl_file); // Read the type (ALIAS_SINGLE or ALIAS_SKIN_GROUP), cast to void to suppress unused warning
-        // For simplicity in reverse engineering, we treat skin groups as sequential skins
-        // and just read their raw pixel data. The skin_type_int indicates if it was part
-        // of a group, but the data structure for pixel data is the same.
-
-        byte *skin_data = (byte *)malloc(header.skinwidth * header.skinheight);
-        if (!skin_data) {
-            Error("Failed to allocate memory for skin data.");
-        }
-        SafeRead(mdl_file, skin_data, header.skinwidth * header.skinheight);
-
-        char skin_filename[1024]; // Increased buffer size to 1024
-        sprintf(skin_filename, "%s_skin%d.lbm", out_filename_base, i);
-        printf("  Saving skin %d to %s (%dx%d pixels)\n", i, skin_filename, header.skinwidth, header.skinheight);
-        // Use the loaded Quake palette here
-        WriteLBMfile(skin_filename, skin_data, header.skinwidth, header.skinheight, loaded_palette);
-        free(skin_data);
-    }
-
-    // --- Read ST Vertices (Texture Coordinates) ---
-    // These are read to advance the file pointer past this section.
-    // They are not directly needed for the .tri geometry output but describe
-    // how vertices map to the 2D texture.
-    printf("\nReading ST Vertices...\n");
-    stvert_t *st_verts = (stvert_t *)malloc(header.numverts * sizeof(stvert_t));
-    if (!st_verts) {
-        Error("Failed to allocate memory for ST vertices.");
-    }
-    for (int i = 0; i < header.numverts; i++) {
-        st_verts[i].onseam = ReadLittleLong(mdl_file);
-        st_verts[i].s = ReadLittleLong(mdl_file);
-        st_verts[i].t = ReadLittleLong(mdl_file);
-    }
-
-    // --- Read Triangles (Vertex Indices) ---
-    // These define the triangles by referencing indices into the vertex list.
-    // They are crucial for reconstructing the 3D geometry of each frame.
-    printf("Reading Triangle Indices...\n");
-    dtriangle_t *triangles_indices = (dtriangle_t *)malloc(header.numtris * sizeof(dtriangle_t));
-    if (!triangles_indices) {
-        Error("Failed to allocate memory for triangle indices.");
-    }
-    for (int i = 0; i < header.numtris; i++) {
-        triangles_indices[i].facesfront = ReadLittleLong(mdl_file);
-        triangles_indices[i].vertindex[0] = ReadLittleLong(mdl_file);
-        triangles_indices[i].vertindex[1] = ReadLittleLong(mdl_file);
-        triangles_indices[i].vertindex[2] = ReadLittleLong(mdl_file);
-    }
-
-    // --- Extract Frames ---
-    // Iterate through all frames, including single frames and frames within groups.
-    printf("\nExtracting Frames...\n");
-    long current_file_pos = ftell(mdl_file);
-    printf("  Initial file position for frame reading: %ld\n", current_file_pos);
-
-    for (int i = 0; i < header.numframes; ) { // 'i' is incremented inside the loop based on frame type
-        int frame_type_int = ReadLittleLong(mdl_file); // Read the frame type (ALIAS_SINGLE or ALIAS_GROUP)
-        printf("  Frame entry %d: Type %d (File pos after reading type: %ld)\n", i, frame_type_int, ftell(mdl_file));
-
-        if (frame_type_int == ALIAS_SINGLE) {
-            daliasframe_t frame_info;
-            SafeRead(mdl_file, &frame_info, sizeof(frame_info));
-            printf("    Single frame '%s' info read (File pos after reading daliasframe_t: %ld)\n", frame_info.name, ftell(mdl_file));
-
-            trivertx_t *frame_verts_raw = (trivertx_t *)malloc(header.numverts * sizeof(trivertx_t));
-            if (!frame_verts_raw) {
-                Error("Failed to allocate memory for frame vertices.");
-            }
-            SafeRead(mdl_file, frame_verts_raw, header.numverts * sizeof(trivertx_t));
-            printf("    Single frame vertex data read (File pos after reading vertices: %ld)\n", ftell(mdl_file));
+// WriteLittleLongToBuffer: Writes a 4-byte integer to a buffer in Little-Endian format.
+void WriteLittleLongToBuffer(byte* buffer, unsigned int val) {
+    buffer[0] = (byte)(val & 0xFF);
+    buffer[1] = (byte)((val >> 8) & 0xFF);
+    buffer[2] = (byte)((val >> 16) & 0xFF);
+    buffer[3] = (byte)((val >> 24) & 0xFF);
+}
 
+// OpenPak: Creates filename and reserves room for the header. The directory
+// buffer is kept from the previous model.
+void OpenPak (pakfile_t *pak, char *filename)
+{
+    byte header[12] = { 0 };
+    snprintf(pak->filename, sizeof(pak->filename), "%s", filename);
+    pak->f = SafeOpenOutput(filename);
+    SafeWrite(pak->f, header, sizeof(header));
+    pak->pos = sizeof(header);
+    pak->numentries = 0;
+}
 
-            // Prepare memory for reconstructed triangle vertices (float X,Y,Z)
-            triangle_t *current_frame_triangles = (triangle_t *)malloc(header.numtris * sizeof(triangle_t));
-            if (!current_frame_triangles) {
-                Error("Failed to allocate memory for current frame triangles.");
-            }
+// AddToPak: Appends one payload. Safe to call from several frame threads.
+void AddToPak (pakfile_t *pak, outputkind_t kind, int index, const char *filename, const byte *data, size_t len)
+{
+    const char *name = strrchr(filename, '/');
+    name = name ? name + 1 : filename;
+    if (strlen(name) >= MAX_PAKNAME)
+        Error("%s: entry name %s is longer than %d characters.", pak->filename, name, MAX_PAKNAME - 1);
 
-            // Reconstruct float vertices from byte-packed data using scale and origin from MDL header
-            for (int t = 0; t < header.numtris; t++) {
-                for (int v_idx = 0; v_idx < 3; v_idx++) { // Loop 3 times for each vertex of the triangle
-                    int vert_index = triangles_indices[t].vertindex[v_idx]; // Get the actual vertex index
-                    trivertx_t raw_vert = frame_verts_raw[vert_index]; // Get the byte-packed vertex data
-
-                    // Reverse the scaling and translation applied by modelgen.c:
-                    // original_float_v = (byte_v * header.scale[k]) + header.scale_origin[k]
-                    current_frame_triangles[t].verts[v_idx][0] = (float)raw_vert.v[0] * header.scale[0] + header.scale_origin[0];
-                    current_frame_triangles[t].verts[v_idx][1] = (float)raw_vert.v[1] * header.scale[1] + header.scale_origin[1];
-                    current_frame_triangles[t].verts[v_idx][2] = (float)raw_vert.v[2] * header.scale[2] + header.scale_origin[2];
-                }
-            }
+    pthread_mutex_lock(&pak->lock);
+    if ((size_t)pak->pos + len > INT_MAX) {
+        pthread_mutex_unlock(&pak->lock);
+        Error("%s: container would exceed 2 GB.", pak->filename);
+    }
+    if (pak->numentries == pak->maxentries) {
+        int maxentries = pak->maxentries ? pak->maxentries * 2 : 256;
+        pakentry_t *dir = (pakentry_t *)CountedRealloc(pak->dir, maxentries * sizeof(pakentry_t));
+        if (!dir) {
+            pthread_mutex_unlock(&pak->lock);
+            Error("Failed to allocate the container directory.");
+        }
+        pak->allocations++;
+        pak->dir = dir;
+        pak->maxentries = maxentries;
+    }
+    pakentry_t *e = &pak->dir[pak->numentries++];
+    memset(e->name, 0, sizeof(e->name));
+    strcpy(e->name, name);
+    e->filepos = pak->pos;
+    e->filelen = (int)len;
+    e->sortkey = ((int)kind << 24) | index;
+    size_t written = fwrite(data, 1, len, pak->f);
+    pak->pos += (int)len;
+    pthread_mutex_unlock(&pak->lock);
+
+    if (written != len)
+        Error("%s: write failure: %s", pak->filename, strerror(errno));
+}
 
-            char frame_filename[1024]; // Increased buffer size to 1024
-            sprintf(frame_filename, "%s_frame%d.tri", out_filename_base, i);
-            printf("  Saving frame %d ('%s') to %s\n", i, frame_info.name, frame_filename);
-            WriteTriFile(frame_filename, current_frame_triangles, header.numtris);
+int ComparePakEntries (const void *a, const void *b)
+{
+    return ((const pakentry_t *)a)->sortkey - ((const pakentry_t *)b)->sortkey;
+}
 
-            free(frame_verts_raw);
-            free(current_frame_triangles);
-            i++; // Move to the next frame in the MDL file
-        } else if (frame_type_int == ALIAS_GROUP) {
-            daliasgroup_t group_info_raw; // Read the raw bytes into this struct
-            SafeRead(mdl_file, &group_info_raw, sizeof(group_info_raw));
-            printf("    Frame group struct read (File pos after reading daliasgroup_t: %ld)\n", ftell(mdl_file));
+// ClosePak: Writes the sorted directory and patches the header.
+void ClosePak (pakfile_t *pak)
+{
+    byte entry[64], header[12];
 
-            // The actual number of frames for the group is in group_info_raw.numframes.
-            // Based on flame.mdl's behavior, it appears to be Little-Endian despite modelgen.c.
-            int actual_group_numframes = group_info_raw.numframes; // No BigLongToHost here
+    qsort(pak->dir, pak->numentries, sizeof(pakentry_t), ComparePakEntries);
+    for (int i = 0; i < pak->numentries; i++) {
+        memcpy(entry, pak->dir[i].name, MAX_PAKNAME);
+        WriteLittleLongToBuffer(entry + 56, pak->dir[i].filepos);
+        WriteLittleLongToBuffer(entry + 60, pak->dir[i].filelen);
+        SafeWrite(pak->f, entry, sizeof(entry));
+    }
 
-            printf("    Frame group info read. Contains %d sub-frames (from struct member conversion).\n", actual_group_numframes);
-            printf("    File pos after processing group header: %ld\n", ftell(mdl_file));
+    WriteLittleLongToBuffer(header, IDPAKHEADER);
+    WriteLittleLongToBuffer(header + 4, pak->pos);
+    WriteLittleLongToBuffer(header + 8, pak->numentries * 64);
+    if (fseek(pak->f, 0, SEEK_SET) != 0)
+        Error("%s: seek failure: %s", pak->filename, strerror(errno));
+    SafeWrite(pak->f, header, sizeof(header));
+    if (fclose(pak->f) != 0)
+        Error("%s: write failure: %s", pak->filename, strerror(errno));
+    pak->f = NULL;
+}
 
 
-            // Sanity check for numframes to prevent large erroneous reads
-            if (actual_group_numframes <= 0 || actual_group_numframes > 10000) { // Arbitrary but large upper bound
-                Error("Suspicious number of sub-frames (%d) detected in frame group. File might be corrupted or an unsupported format (expected 1 to 10000).", actual_group_numframes);
-            }
+// --- Tar Stream Output ---
+// With --stdout, every output is written to stdout as a member of a POSIX ustar
+// archive, so the converter can sit in a pipeline (PAK extractor | mdl2tri - |
+// uploader) with no temporary files. Members are streamed as soon as each is
+// built; memory use does not grow with the number of outputs.
+qboolean        output_stdout;
+pthread_mutex_t tar_lock = PTHREAD_MUTEX_INITIALIZER;
 
-            // Skip interval data for group frames (timing information, not geometry)
-            printf("    Reading %d interval floats (File pos before intervals: %ld)\n", actual_group_numframes, ftell(mdl_file));
-            for (int j = 0; j < actual_group_numframes; j++) {
-                (void)ReadLittleFloat(mdl_file); // cast to void to suppress unused warning
-            }
-            printf("    Finished reading intervals (File pos after intervals: %ld)\n", ftell(mdl_file));
-
-            // Process each individual frame within the group
-            for (int j = 0; j < actual_group_numframes; j++) {
-                daliasframe_t frame_info; // Each group frame still has a daliasframe_t header
-                SafeRead(mdl_file, &frame_info, sizeof(frame_info));
-                printf("      Sub-frame %d ('%s') info read (File pos after sub-frame info: %ld)\n", j, frame_info.name, ftell(mdl_file));
-
-                trivertx_t *frame_verts_raw = (trivertx_t *)malloc(header.numverts * sizeof(trivertx_t));
-                if (!frame_verts_raw) {
-                    Error("Failed to allocate memory for frame vertices in group.");
-                }
-                SafeRead(mdl_file, frame_verts_raw, header.numverts * sizeof(trivertx_t));
-                printf("      Sub-frame %d vertex data read (File pos after sub-frame vertices: %ld)\n", j, ftell(mdl_file));
-
-                triangle_t *current_frame_triangles = (triangle_t *)malloc(header.numtris * sizeof(triangle_t));
-                if (!current_frame_triangles) {
-                    Error("Failed to allocate memory for current frame triangles.");
-                }
-
-                // Reconstruct float vertices for group frame
-                for (int t = 0; t < header.numtris; t++) {
-                    for (int v_idx = 0; v_idx < 3; v_idx++) {
-                        int vert_index = triangles_indices[t].vertindex[v_idx];
-                        trivertx_t raw_vert = frame_verts_raw[vert_index];
-
-                        current_frame_triangles[t].verts[v_idx][0] = (float)raw_vert.v[0] * header.scale[0] + header.scale_origin[0];
-                        current_frame_triangles[t].verts[v_idx][1] = (float)raw_vert.v[1] * header.scale[1] + header.scale_origin[1];
-                        current_frame_triangles[t].verts[v_idx][2] = (float)raw_vert.v[2] * header.scale[2] + header.scale_origin[2];
-                    }
-                }
-
-                char frame_filename[1024]; // Increased buffer size to 1024
-                // Naming convention for group frames: base_frame<group_start_idx>_sub<sub_frame_idx>.tri
-                sprintf(frame_filename, "%s_frame%d_sub%d.tri", out_filename_base, i, j);
-                printf("  Saving group frame %d (sub-frame %d '%s') to %s\n", i, j, frame_info.name, frame_filename);
-                WriteTriFile(frame_filename, current_frame_triangles, header.numtris);
-
-                free(frame_verts_raw);
-                free(current_frame_triangles);
-            }
-            i += (1 + actual_group_numframes); // Advance 'i' past group header and all frames within the group
-        } else {
-            Error("Unknown frame type encountered: %d. File may be corrupted or an unsupported format.", frame_type_int);
-        }
+// TarOctal: Writes val as a zero-padded, null-terminated octal field.
+void TarOctal (char *field, int size, unsigned long long val)
+{
+    field[size - 1] = '\0';
+    for (int i = size - 2; i >= 0; i--) {
+        field[i] = (char)('0' + (val & 7));
+        val >>= 3;
+    }
+}
+
+// WriteTarEntry: Writes one regular-file member (header, data, padding).
+void WriteTarEntry (FILE *out, const char *name, const byte *data, size_t len)
+{
+    char header[512];
+    static const char padding[512];
+
+    while (name[0] == '/')
+        name++;
+    while (name[0] == '.' && name[1] == '/')
+        name += 2;
+
+    memset(header, 0, sizeof(header));
+    size_t namelen = strlen(name);
+    if (namelen <= 100) {
+        memcpy(header, name, namelen);
+    } else {
+        // Split long paths into the ustar prefix (155) and name (100) fields
+        const char *split = name + namelen - 101;
+        while (*split && *split != '/')
+            split++;
+        if (!*split || split - name > 155 || strlen(split + 1) > 100)
+            Error("Output name %s is too long for a tar stream.", name);
+        memcpy(header + 345, name, split - name);
+        memcpy(header, split + 1, strlen(split + 1));
     }
+    if ((unsigned long long)len > 077777777777ULL)
+        Error("Output %s is too large for a tar stream.", name);
+
+    TarOctal(header + 100, 8, 0644);    // mode
+    TarOctal(header + 108, 8, 0);       // uid
+    TarOctal(header + 116, 8, 0);       // gid
+    TarOctal(header + 124, 12, len);    // size
+    TarOctal(header + 136, 12, 0);      // mtime
+    header[156] = '0';                  // typeflag: regular file
+    memcpy(header + 257, "ustar", 6);   // magic
+    memcpy(header + 263, "00", 2);      // version
+
+    // Checksum is computed with the checksum field itself set to spaces
+    unsigned int sum = 0;
+    memset(header + 148, ' ', 8);
+    for (int i = 0; i < 512; i++)
+        sum += (byte)header[i];
+    TarOctal(header + 148, 7, sum);
+    header[155] = ' ';
+
+    pthread_mutex_lock(&tar_lock);
+    size_t pad = (512 - (len & 511)) & 511;
+    int ok = fwrite(header, 1, 512, out) == 512
+          && fwrite(data, 1, len, out) == len
+          && fwrite(padding, 1, pad, out) == pad;
+    pthread_mutex_unlock(&tar_lock);
+    if (!ok)
+        Error("Error writing tar stream: %s", strerror(errno));
+}
+
+// FinishTarStream: Writes the two zero blocks that end an archive.
+void FinishTarStream (FILE *out)
+{
+    static const char zeros[1024];
+    if (fwrite(zeros, 1, sizeof(zeros), out) != sizeof(zeros) || fflush(out) != 0)
+        Error("Error writing tar stream: %s", strerror(errno));
+}
+
+
+// --- Output Queue ---
+// Loose output files are handed to a pool of writer threads, so frames and skins
+// keep decoding while earlier outputs are being opened, written and closed. This
+// pays off most where the latency is per file (network file systems), since up to
+// --writers files are in flight at once. The queue holds at most --write-queue
+// outputs; a producer that finds every slot taken waits for a writer. Each slot
+// keeps its buffers between outputs, so after the first few models it is filled
+// without heap allocations. Containers and the tar stream are single files and
+// are still written in order by the thread converting the model.
+#define MAX_WRITERS     64
+
+int output_writers = 4;     // --writers: writer threads, 0 to write synchronously
+int output_queue_depth;     // --write-queue: outputs in flight, 0 = 4 per writer
 
-    // Clean up allocated memory
-    free(st_verts);
-    free(triangles_indices);
-	fclose(mdl_file);
+// The outputs of one model; the model is finished once they are all written
+typedef struct {
+    int         pending;        // Queued or being written
+    int         failed;
+    char        message[1024];  // First write error
+    size_t      *memory;        // Worker memory counter queued copies are charged to, or NULL
+} writebatch_t;
+
+typedef struct {
+    char            *filename;
+    size_t          filenamesize;
+    byte            *data;
+    size_t          datasize;
+    size_t          len;
+    writebatch_t    *batch;
+    size_t          charged;        // Buffer bytes charged to batch->memory while queued
+} writeslot_t;
+
+typedef struct {
+    writeslot_t     *slots;
+    int             numslots;
+    int             *ring;          // Queued slots, oldest first
+    int             head;
+    int             count;
+    int             *freeslots;     // Slots not in use
+    int             numfree;
+    qboolean        shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t  queued;         // A slot was queued, or shutdown
+    pthread_cond_t  released;       // A slot was freed and a batch made progress
+    pthread_t       threads[MAX_WRITERS];
+    int             numthreads;
+} writequeue_t;
+
+writequeue_t write_queue;
+
+// WriteSlot: Writes one queued output. Runs on a writer thread, which has no
+// conversion to unwind, so failures are reported instead of raised.
+qboolean WriteSlot (const writeslot_t *slot, char *message, size_t size)
+{
+    FILE *f = OpenOutput(slot->filename, "wb");
+    if (!f) {
+        snprintf(message, size, "Error opening %s for write: %s", slot->filename, strerror(errno));
+        return false;
+    }
+    size_t written = fwrite(slot->data, 1, slot->len, f);
+    if ((written != slot->len) | ferror(f) | fclose(f)) {
+        snprintf(message, size, "Error writing %s: %s", slot->filename, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void *WriterThread (void *p)
+{
+    writequeue_t *q = (writequeue_t *)p;
+    char message[1024];
+
+    pthread_mutex_lock(&q->lock);
+    for (;;) {
+        while (!q->count && !q->shutdown)
+            pthread_cond_wait(&q->queued, &q->lock);
+        if (!q->count)
+            break;
+        int s = q->ring[q->head];
+        q->head = (q->head + 1) % q->numslots;
+        q->count--;
+        pthread_mutex_unlock(&q->lock);
+
+        writeslot_t *slot = &q->slots[s];
+        qboolean ok = WriteSlot(slot, message, sizeof(message));
+
+        pthread_mutex_lock(&q->lock);
+        if (!ok && !slot->batch->failed) {
+            slot->batch->failed = 1;
+            snprintf(slot->batch->message, sizeof(slot->batch->message), "%s", message);
+        }
+        ReleaseMemory(slot->batch->memory, slot->charged);
+        slot->charged = 0;
+        slot->batch->pending--;
+        slot->batch = NULL;
+        q->freeslots[q->numfree++] = s;
+        pthread_cond_broadcast(&q->released);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+// StartWriters: Starts the writer threads and allocates the queue's slots.
+void StartWriters (writequeue_t *q, int writers, int depth)
+{
+    memset(q, 0, sizeof(*q));
+    if (writers > MAX_WRITERS)
+        writers = MAX_WRITERS;
+    if (depth < writers)
+        depth = writers;
+    q->slots = (writeslot_t *)calloc(depth, sizeof(writeslot_t));
+    q->ring = (int *)malloc(depth * sizeof(int));
+    q->freeslots = (int *)malloc(depth * sizeof(int));
+    if (!q->slots || !q->ring || !q->freeslots)
+        Error("Failed to allocate the output queue.");
+    q->numslots = depth;
+    for (int i = 0; i < depth; i++)
+        q->freeslots[q->numfree++] = depth - 1 - i;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->queued, NULL);
+    pthread_cond_init(&q->released, NULL);
+    for (int i = 0; i < writers; i++) {
+        if (pthread_create(&q->threads[i], NULL, WriterThread, q) != 0)
+            Error("pthread_create failed");
+        q->numthreads++;
+    }
+}
+
+// StopWriters: Lets the writers drain the queue, then joins them and frees it.
+void StopWriters (writequeue_t *q)
+{
+    if (!q->numthreads)
+        return;
+    pthread_mutex_lock(&q->lock);
+    q->shutdown = true;
+    pthread_cond_broadcast(&q->queued);
+    pthread_mutex_unlock(&q->lock);
+    for (int i = 0; i < q->numthreads; i++)
+        pthread_join(q->threads[i], NULL);
+    for (int i = 0; i < q->numslots; i++) {
+        free(q->slots[i].filename);
+        free(q->slots[i].data);
+    }
+    free(q->slots);
+    free(q->ring);
+    free(q->freeslots);
+    pthread_cond_destroy(&q->queued);
+    pthread_cond_destroy(&q->released);
+    pthread_mutex_destroy(&q->lock);
+    memset(q, 0, sizeof(*q));
+}
+
+// SlotBufferSize: What a slot buffer of buffersize bytes grows to for size bytes.
+size_t SlotBufferSize (size_t buffersize, size_t size)
+{
+    if (size <= buffersize)
+        return buffersize;
+    size_t newsize = buffersize ? buffersize : 4096;
+    while (newsize < size)
+        newsize *= 2;
+    return newsize;
+}
+
+// GrowSlotBuffer: Makes a slot buffer hold at least size bytes. Returns false,
+// leaving the buffer as it was, if that cannot be allocated.
+qboolean GrowSlotBuffer (void **buffer, size_t *buffersize, size_t size)
+{
+    if (size <= *buffersize)
+        return true;
+    size_t newsize = SlotBufferSize(*buffersize, size);
+    void *p = CountedRealloc(*buffer, newsize);
+    if (!p)
+        return false;
+    *buffer = p;
+    *buffersize = newsize;
+    return true;
+}
+
+// QueueOutput: Copies an output into a free slot, waiting for one if the queue is
+// full, and hands it to the writers. The caller's buffer is free once this returns.
+// The output only counts as pending for batch once it is queued, so a failure
+// here leaves neither a lost slot nor a batch waiting for it. Until a writer has
+// written it, the slot's buffers count against the batch's --max-memory; a copy
+// that does not fit waits for the batch's earlier outputs to be written first.
+void QueueOutput (writequeue_t *q, writebatch_t *batch, const char *filename, const byte *data, size_t len)
+{
+    size_t namelen = strlen(filename) + 1;
+    writeslot_t *slot;
+    size_t charge;
+    int s;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (!q->numfree)
+            pthread_cond_wait(&q->released, &q->lock);
+        s = q->freeslots[--q->numfree];
+        pthread_mutex_unlock(&q->lock);
+
+        slot = &q->slots[s];
+        charge = SlotBufferSize(slot->filenamesize, namelen) + SlotBufferSize(slot->datasize, len);
+        if (TryChargeMemory(batch->memory, charge))
+            break;
+
+        pthread_mutex_lock(&q->lock);
+        q->freeslots[q->numfree++] = s;
+        pthread_cond_broadcast(&q->released);
+        int pending = batch->pending;
+        if (!pending) {
+            pthread_mutex_unlock(&q->lock);
+            Error("Queued copy of %s needs %zu bytes; the worker already holds %zu of --max-memory %zu.",
+                  filename, charge, *batch->memory, max_memory);
+        }
+        while (batch->pending && batch->pending >= pending)
+            pthread_cond_wait(&q->released, &q->lock);
+        pthread_mutex_unlock(&q->lock);
+    }
+
+    if (!GrowSlotBuffer((void **)&slot->filename, &slot->filenamesize, namelen)
+        || !GrowSlotBuffer((void **)&slot->data, &slot->datasize, len)) {
+        ReleaseMemory(batch->memory, charge);
+        pthread_mutex_lock(&q->lock);
+        q->freeslots[q->numfree++] = s;
+        pthread_cond_broadcast(&q->released);
+        pthread_mutex_unlock(&q->lock);
+        Error("Failed to allocate %zu bytes for the output queue.", len);
+    }
+    slot->charged = charge;
+    memcpy(slot->filename, filename, namelen);
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->batch = batch;
+
+    pthread_mutex_lock(&q->lock);
+    batch->pending++;
+    q->ring[(q->head + q->count) % q->numslots] = s;
+    q->count++;
+    pthread_cond_signal(&q->queued);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// WaitForOutputs: Blocks until every output queued for batch is on disk. Returns
+// false, with the first failure in message, if any of them could not be written.
+qboolean WaitForOutputs (writequeue_t *q, writebatch_t *batch, char *message, size_t size)
+{
+    pthread_mutex_lock(&q->lock);
+    while (batch->pending)
+        pthread_cond_wait(&q->released, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+    if (!batch->failed)
+        return true;
+    snprintf(message, size, "%s", batch->message);
+    batch->failed = 0;
+    return false;
+}
+
+
+// --- Incremental Output Cache ---
+// With --incremental every model keeps a manifest, <base>.mdlcache, next to its
+// outputs. It records a hash of the input file and of the options that shape the
+// outputs, then the hash, length and name of every output written. A model
+// whose input and options hash the same as last time, and whose outputs are all
+// still there, is skipped. In a changed model, an output whose bytes hash the
+// same as the file already on disk is not rewritten. Hashes are 64-bit FNV-1a.
+#define CACHE_VERSION   1   // Bump when any output format changes
+#define FNV_OFFSET      14695981039346656037ULL
+#define FNV_PRIME       1099511628211ULL
+
+qboolean            output_incremental;
+unsigned long long  options_hash;   // Hash of every option that changes the outputs
+
+// HashBytes: Continues an FNV-1a hash over len bytes (start with FNV_OFFSET).
+unsigned long long HashBytes (const void *data, size_t len, unsigned long long hash)
+{
+    const byte *p = (const byte *)data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    return hash;
+}
+
+typedef struct {
+    unsigned long long  namehash;   // Hash of the name; entries are found by it
+    unsigned long long  hash;       // Hash of the output bytes
+    size_t              len;
+    size_t              name;       // Offset of the name in the list's name pool
+} cacheentry_t;
+
+typedef struct {
+    cacheentry_t    *entries;
+    int             numentries;
+    int             maxentries;
+    char            *names;
+    size_t          nameslen;
+    size_t          namessize;
+} cachelist_t;
+
+typedef struct {
+    cachelist_t     old;            // Outputs of the previous run, sorted by namehash
+    cachelist_t     out;            // Outputs of this run
+    qboolean        valid;          // A manifest was read
+    unsigned long long inputhash;   // From the manifest
+    size_t          inputsize;
+    unsigned long long optionshash;
+    int             unchanged;      // Outputs of this run that were not rewritten
+    int             allocations;
+    pthread_mutex_t lock;           // Frame threads add to out concurrently
+} outputcache_t;
+
+// AddCacheEntry: Appends an output to a cache list. Returns false, leaving the
+// list as it was, if it cannot grow; the caller decides what that costs.
+qboolean AddCacheEntry (outputcache_t *cache, cachelist_t *list, const char *name, unsigned long long hash, size_t len)
+{
+    size_t namelen = strlen(name) + 1;
+    if (list->numentries == list->maxentries) {
+        int max = list->maxentries ? list->maxentries * 2 : 256;
+        cacheentry_t *entries = (cacheentry_t *)CountedRealloc(list->entries, max * sizeof(cacheentry_t));
+        if (!entries)
+            return false;
+        cache->allocations++;
+        list->entries = entries;
+        list->maxentries = max;
+    }
+    if (list->nameslen + namelen > list->namessize) {
+        size_t size = list->namessize ? list->namessize * 2 : 16384;
+        while (size < list->nameslen + namelen)
+            size *= 2;
+        char *names = (char *)CountedRealloc(list->names, size);
+        if (!names)
+            return false;
+        cache->allocations++;
+        list->names = names;
+        list->namessize = size;
+    }
+    cacheentry_t *e = &list->entries[list->numentries++];
+    e->namehash = HashBytes(name, namelen - 1, FNV_OFFSET);
+    e->hash = hash;
+    e->len = len;
+    e->name = list->nameslen;
+    memcpy(list->names + list->nameslen, name, namelen);
+    list->nameslen += namelen;
+    return true;
+}
+
+int CompareCacheEntries (const void *a, const void *b)
+{
+    unsigned long long x = ((const cacheentry_t *)a)->namehash, y = ((const cacheentry_t *)b)->namehash;
+    return x < y ? -1 : x > y;
+}
+
+// FindCacheEntry: Looks name up in the previous run's outputs.
+const cacheentry_t *FindCacheEntry (const outputcache_t *cache, const char *name)
+{
+    unsigned long long namehash = HashBytes(name, strlen(name), FNV_OFFSET);
+    int lo = 0, hi = cache->old.numentries;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cache->old.entries[mid].namehash < namehash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for ( ; lo < cache->old.numentries && cache->old.entries[lo].namehash == namehash; lo++) {
+        if (!strcmp(cache->old.names + cache->old.entries[lo].name, name))
+            return &cache->old.entries[lo];
+    }
+    return NULL;
+}
+
+// OutputExists: Whether filename is on disk with the given length.
+qboolean OutputExists (const char *filename, size_t len)
+{
+    struct stat st;
+    return StatOutput(filename, &st) == 0 && S_ISREG(st.st_mode) && (size_t)st.st_size == len;
+}
+
+// LoadManifest: Reads a model's manifest from the previous run, if there is one.
+// A missing, damaged or unloadable manifest just means nothing is known to be
+// current: the model is rebuilt in full, and nothing here fails the model.
+void LoadManifest (outputcache_t *cache, const char *filename)
+{
+    char line[1200];
+    int version;
+
+    cache->old.numentries = cache->old.nameslen = 0;
+    cache->out.numentries = cache->out.nameslen = 0;
+    cache->valid = false;
+    cache->unchanged = 0;
+
+    FILE *f = OpenOutput(filename, "r");
+    if (!f)
+        return;
+    if (!fgets(line, sizeof(line), f) || sscanf(line, "mdlcache %d", &version) != 1 || version != CACHE_VERSION
+        || !fgets(line, sizeof(line), f) || sscanf(line, "input %llx %zu", &cache->inputhash, &cache->inputsize) != 2
+        || !fgets(line, sizeof(line), f) || sscanf(line, "options %llx", &cache->optionshash) != 1) {
+        fclose(f);
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long hash;
+        size_t len;
+        int start;
+        size_t end = strcspn(line, "\r\n");
+        qboolean whole = line[end] || feof(f);   // Not cut short by the buffer
+        line[end] = '\0';
+        if (!whole || sscanf(line, "%llx %zu %n", &hash, &len, &start) != 2 || !line[start]
+            || !AddCacheEntry(cache, &cache->old, line + start, hash, len)) {
+            cache->old.numentries = cache->old.nameslen = 0;
+            fclose(f);
+            return;     // Damaged or too large; treat everything as changed
+        }
+    }
+    fclose(f);
+    qsort(cache->old.entries, cache->old.numentries, sizeof(cacheentry_t), CompareCacheEntries);
+    cache->valid = true;
+}
+
+// ModelUpToDate: Whether the previous run converted this exact input with the
+// same options, and all its outputs are still in place.
+qboolean ModelUpToDate (const outputcache_t *cache, unsigned long long inputhash, size_t inputsize)
+{
+    if (!cache->valid || cache->inputhash != inputhash || cache->inputsize != inputsize
+        || cache->optionshash != options_hash)
+        return false;
+    for (int i = 0; i < cache->old.numentries; i++) {
+        const cacheentry_t *e = &cache->old.entries[i];
+        if (!OutputExists(cache->old.names + e->name, e->len))
+            return false;
+    }
+    return true;
+}
+
+// CacheOutput: Records an output of this run. Returns true if the file on disk
+// already holds exactly these bytes, so it need not be written again.
+qboolean CacheOutput (outputcache_t *cache, const char *filename, const byte *data, size_t len)
+{
+    unsigned long long hash = HashBytes(data, len, FNV_OFFSET);
+    const cacheentry_t *e = cache->valid ? FindCacheEntry(cache, filename) : NULL;
+    qboolean unchanged = e && e->hash == hash && e->len == len && OutputExists(filename, len);
+
+    pthread_mutex_lock(&cache->lock);
+    qboolean added = AddCacheEntry(cache, &cache->out, filename, hash, len);
+    if (added && unchanged)
+        cache->unchanged++;
+    pthread_mutex_unlock(&cache->lock);
+    if (!added)
+        Error("Failed to allocate the output cache.");
+    return unchanged;
+}
+
+// WriteManifest: Writes this run's manifest through a temporary file, so an
+// interrupted run never leaves a manifest that claims outputs it did not write.
+void WriteManifest (outputcache_t *cache, const char *filename, unsigned long long inputhash, size_t inputsize)
+{
+    char tmpname[1100];
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+    FILE *f = SafeOpenOutput(tmpname);
+    fprintf(f, "mdlcache %d\ninput %016llx %zu\noptions %016llx\n", CACHE_VERSION, inputhash, inputsize, options_hash);
+    for (int i = 0; i < cache->out.numentries; i++) {
+        const cacheentry_t *e = &cache->out.entries[i];
+        fprintf(f, "%016llx %zu %s\n", e->hash, e->len, cache->out.names + e->name);
+    }
+    if (ferror(f) | fclose(f))
+        Error("Error writing %s: %s", tmpname, strerror(errno));
+    if (RenameOutput(tmpname, filename) != 0)
+        Error("Error renaming %s to %s: %s", tmpname, filename, strerror(errno));
+}
+
+void FreeOutputCache (outputcache_t *cache)
+{
+    free(cache->old.entries);
+    free(cache->old.names);
+    free(cache->out.entries);
+    free(cache->out.names);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+
+// --- Statistics ---
+// Every model records the wall time, bytes and item count of each conversion
+// phase, so --stats can show whether a run is bound by I/O (load, write) or by
+// decoding. The frame phases run on several threads at once; their times are
+// summed over the threads, so they can exceed the model's wall time.
+typedef enum {
+    PHASE_LOAD,     // Mapping or reading the input file
+    PHASE_HEADER,   // Header parse and validation
+    PHASE_SKINS,    // Skin extraction; bytes are .lbm output
+    PHASE_MESH,     // Model parse and UV table; bytes are ST vertex and triangle input
+    PHASE_DECODE,   // Frame dequantize, normals and --resample blends; bytes are input
+    PHASE_WRITE,    // Building and writing the outputs of each format; bytes are output
+    NUM_PHASES
+} phase_t;
+
+static const char *phase_names[NUM_PHASES] = { "load", "header", "skins", "mesh", "decode", "write" };
+
+typedef struct {
+    double  seconds;
+    size_t  bytes;
+    int     count;
+} phasestat_t;
+
+typedef struct {
+    phasestat_t phase[NUM_PHASES];
+    double      seconds;    // Wall time of the whole model (or batch)
+    int         models;
+    int         failed;
+} stats_t;
+
+typedef enum { STATS_NONE, STATS_TEXT, STATS_JSON } statsmode_t;
+
+statsmode_t stats_mode; // --stats[=json]
+
+// I_FloatTime: Seconds on a monotonic clock.
+double I_FloatTime (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// AddPhase: Charges the time since start and bytes to one phase.
+void AddPhase (stats_t *stats, phase_t phase, double start, size_t bytes)
+{
+    stats->phase[phase].seconds += I_FloatTime() - start;
+    stats->phase[phase].bytes += bytes;
+    stats->phase[phase].count++;
+}
+
+// AddStats: Accumulates one set of statistics into another.
+void AddStats (stats_t *total, const stats_t *stats)
+{
+    for (int i = 0; i < NUM_PHASES; i++) {
+        total->phase[i].seconds += stats->phase[i].seconds;
+        total->phase[i].bytes += stats->phase[i].bytes;
+        total->phase[i].count += stats->phase[i].count;
+    }
+    total->seconds += stats->seconds;
+    total->models += stats->models;
+    total->failed += stats->failed;
+}
+
+// PrintStats: Prints one statistics record as a table.
+void PrintStats (FILE *out, const char *title, const stats_t *stats)
+{
+    fprintf(out, "\n%s: %.3f s", title, stats->seconds);
+    if (stats->models > 1)
+        fprintf(out, ", %d models (%d failed)", stats->models, stats->failed);
+    fprintf(out, "\n  %-8s %10s %14s %8s %10s\n", "phase", "ms", "bytes", "count", "MB/s");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        const phasestat_t *p = &stats->phase[i];
+        double rate = p->seconds > 0 ? p->bytes / p->seconds / 1e6 : 0;
+        fprintf(out, "  %-8s %10.3f %14zu %8d %10.1f\n", phase_names[i], p->seconds * 1000, p->bytes, p->count, rate);
+    }
+}
+
+// PrintJSONString: Prints s as a quoted JSON string.
+void PrintJSONString (FILE *out, const char *s)
+{
+    fputc('"', out);
+    for ( ; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// PrintStatsJSON: Prints one statistics record as a JSON object.
+void PrintStatsJSON (FILE *out, const stats_t *stats)
+{
+    fprintf(out, "\"seconds\": %.6f, \"models\": %d, \"failed\": %d, \"phases\": {",
+            stats->seconds, stats->models, stats->failed);
+    for (int i = 0; i < NUM_PHASES; i++) {
+        const phasestat_t *p = &stats->phase[i];
+        fprintf(out, "%s\"%s\": {\"seconds\": %.6f, \"bytes\": %zu, \"count\": %d}",
+                i ? ", " : "", phase_names[i], p->seconds, p->bytes, p->count);
+    }
+    fprintf(out, "}");
+}
+
+
+// --- Worker State ---
+// Each worker thread owns its arenas and a log buffer that collects the output
+// of the model it is converting, so messages from concurrently converted models
+// are printed as whole blocks instead of interleaving. Every frame thread gets
+// an arena of its own for the decoded positions, triangle soup and .tri file.
+typedef struct {
+    mdlfile_t   mdl_file;       // Image of the model being converted
+    mdl_t       mdl;            // The model parsed from it; tables are in arena
+    arena_t     arena;          // Frame table and skin output buffers
+    pakfile_t   pak;            // Container for --container output
+    arena_t     *framearenas;   // One per frame thread
+    int         numframearenas;
+    char        *log;           // Collected log text for the current model
+    size_t      log_len;
+    size_t      log_size;
+    int         allocations;    // Heap allocations for the log and arena array
+    size_t      memory;         // Bytes held in arenas, file image and queued outputs, for --max-memory
+    stats_t     stats;          // Phase statistics for the current model
+    outputcache_t cache;        // Manifest of the current model, for --incremental
+    writebatch_t writes;        // Outputs of the current model in the output queue
+} worker_t;
+
+pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+qboolean verbose;   // -v: log every skin and frame
+qboolean log_quiet; // Only log models that fail (--stats=json, --bench)
+
+// LogArgs: Appends formatted text to the worker's log buffer.
+void LogArgs (worker_t *w, char *fmt, va_list args)
+{
+    va_list argptr;
+    for (;;) {
+        size_t avail = w->log_size - w->log_len;
+        va_copy(argptr, args);
+        int n = vsnprintf(w->log ? w->log + w->log_len : NULL, avail, fmt, argptr);
+        va_end(argptr);
+        if (n < 0)
+            return;
+        if ((size_t)n < avail) {
+            w->log_len += n;
+            return;
+        }
+        size_t size = w->log_size ? w->log_size * 2 : 4096;
+        while (size - w->log_len <= (size_t)n)
+            size *= 2;
+        char *log = (char *)CountedRealloc(w->log, size);
+        if (!log)
+            return; // Drop the message rather than fail the conversion
+        w->allocations++;
+        w->log = log;
+        w->log_size = size;
+    }
+}
+
+// Log: Appends formatted text to the worker's log buffer.
+void Log (worker_t *w, char *fmt, ...)
+{
+    va_list argptr;
+    va_start(argptr, fmt);
+    LogArgs(w, fmt, argptr);
+    va_end(argptr);
+}
+
+// LogJSONString: Appends s to the log as a quoted JSON string.
+void LogJSONString (worker_t *w, const char *s)
+{
+    Log(w, "\"");
+    for ( ; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            Log(w, "\\%c", c);
+        else if (c < 0x20)
+            Log(w, "\\u%04x", c);
+        else
+            Log(w, "%c", c);
+    }
+    Log(w, "\"");
+}
+
+// VerboseLog: Like Log, for per-skin and per-frame detail only shown with -v.
+void VerboseLog (worker_t *w, char *fmt, ...)
+{
+    va_list argptr;
+    if (!verbose)
+        return;
+    va_start(argptr, fmt);
+    LogArgs(w, fmt, argptr);
+    va_end(argptr);
+}
+
+// FlushLog: Prints the worker's collected log as one block and empties it.
+void FlushLog (worker_t *w, FILE *out)
+{
+    if (!w->log_len)
+        return;
+    pthread_mutex_lock(&log_lock);
+    fwrite(w->log, 1, w->log_len, out);
+    fflush(out);
+    pthread_mutex_unlock(&log_lock);
+    w->log_len = 0;
+}
+
+// WorkerAllocations: Heap allocations made so far on behalf of this worker.
+int WorkerAllocations (const worker_t *w)
+{
+    int n = w->allocations + w->arena.allocations + w->pak.allocations + w->cache.allocations;
+    for (int i = 0; i < w->numframearenas; i++)
+        n += w->framearenas[i].allocations;
+    return n;
+}
+
+void InitWorker (worker_t *w)
+{
+    memset(w, 0, sizeof(*w));
+    w->arena.memory = &w->memory;
+    w->writes.memory = &w->memory;
+    pthread_mutex_init(&w->pak.lock, NULL);
+    pthread_mutex_init(&w->cache.lock, NULL);
+}
+
+void FreeWorker (worker_t *w)
+{
+    FreeArena(&w->arena);
+    free(w->pak.dir);
+    pthread_mutex_destroy(&w->pak.lock);
+    FreeOutputCache(&w->cache);
+    for (int i = 0; i < w->numframearenas; i++)
+        FreeArena(&w->framearenas[i]);
+    free(w->framearenas);
+    free(w->log);
+    free(w->mdl_file.buffer);
+    ReleaseMemory(&w->memory, w->mdl_file.buffersize);
+    memset(w, 0, sizeof(*w));
+}
+
+
+// Hardcoded Quake Palette (256 colors, RGB)
+// Values provided by the user in hexadecimal 0xRRGGBB format.
+byte loaded_palette[768] = {
+    0x00,0x00,0x00, 0x0f,0x0f,0x0f, 0x1f,0x1f,0x1f, 0x2f,0x2f,0x2f, 0x3f,0x3f,0x3f, 0x4b,0x4b,0x4b, 0x5b,0x5b,0x5b, 0x6b,0x6b,0x6b,
+    0x7b,0x7b,0x7b, 0x8b,0x8b,0x8b, 0x9b,0x9b,0x9b, 0xab,0xab,0xab, 0xbb,0xbb,0xbb, 0xcb,0xcb,0xcb, 0xdb,0xdb,0xdb, 0xeb,0xeb,0xeb,
+    0x0f,0x0b,0x07, 0x17,0x0f,0x0b, 0x1f,0x17,0x0b, 0x27,0x1b,0x0f, 0x2f,0x23,0x13, 0x37,0x2b,0x17, 0x3f,0x2f,0x17, 0x4b,0x37,0x1b,
+    0x53,0x3b,0x1b, 0x5b,0x43,0x1f, 0x63,0x4b,0x1f, 0x6b,0x53,0x1f, 0x73,0x57,0x1f, 0x7b,0x5f,0x23, 0x83,0x67,0x23, 0x8f,0x6f,0x23,
+    0x0b,0x0b,0x0f, 0x13,0x13,0x1b, 0x1b,0x1b,0x27, 0x27,0x27,0x33, 0x2f,0x2f,0x3f, 0x37,0x37,0x4b, 0x3f,0x3f,0x57, 0x47,0x47,0x67,
+    0x4f,0x4f,0x73, 0x5b,0x5b,0x7f, 0x63,0x63,0x8b, 0x6b,0x6b,0x97, 0x73,0x73,0xa3, 0x7b,0x7b,0xaf, 0x83,0x83,0xbb, 0x8b,0x8b,0xcb,
+    0x00,0x00,0x00, 0x07,0x07,0x00, 0x0b,0x0b,0x00, 0x13,0x13,0x00, 0x1b,0x1b,0x00, 0x23,0x23,0x00, 0x2b,0x2b,0x07, 0x2f,0x2f,0x07,
+    0x37,0x37,0x07, 0x3f,0x3f,0x07, 0x47,0x47,0x07, 0x4b,0x4b,0x0b, 0x53,0x53,0x0b, 0x5b,0x5b,0x0b, 0x63,0x63,0x0b, 0x6b,0x6b,0x0f,
+    0x07,0x00,0x00, 0x0f,0x00,0x00, 0x17,0x00,0x00, 0x1f,0x00,0x00, 0x27,0x00,0x00, 0x2f,0x00,0x00, 0x37,0x00,0x00, 0x3f,0x00,0x00,
+    0x47,0x00,0x00, 0x4f,0x00,0x00, 0x57,0x00,0x00, 0x5f,0x00,0x00, 0x67,0x00,0x00, 0x6f,0x00,0x00, 0x77,0x00,0x00, 0x7f,0x00,0x00,
+    0x13,0x13,0x00, 0x1b,0x1b,0x00, 0x23,0x23,0x00, 0x2f,0x2b,0x00, 0x37,0x2f,0x00, 0x43,0x37,0x00, 0x4b,0x3b,0x07, 0x57,0x43,0x07,
+    0x5f,0x47,0x07, 0x6b,0x4b,0x0b, 0x77,0x53,0x0f, 0x83,0x57,0x13, 0x8b,0x5b,0x13, 0x97,0x5f,0x1b, 0xa3,0x63,0x1f, 0xaf,0x67,0x23,
+    0x23,0x13,0x07, 0x2f,0x17,0x0b, 0x3b,0x1f,0x0f, 0x4b,0x23,0x13, 0x57,0x2b,0x17, 0x63,0x2f,0x1f, 0x73,0x37,0x23, 0x7f,0x3b,0x2b,
+    0x8f,0x43,0x33, 0x9f,0x4f,0x33, 0xaf,0x63,0x2f, 0xbf,0x77,0x2f, 0xcf,0x8f,0x2b, 0xdf,0xab,0x27, 0xef,0xcb,0x1f, 0xff,0xf3,0x1b,
+    0x0b,0x07,0x00, 0x1b,0x13,0x00, 0x2b,0x23,0x0f, 0x37,0x2b,0x13, 0x47,0x33,0x1b, 0x53,0x37,0x23, 0x63,0x3f,0x2b, 0x6f,0x47,0x33,
+    0x7f,0x53,0x3f, 0x8b,0x5f,0x47, 0x9b,0x6b,0x53, 0xa7,0x7b,0x5f, 0xb7,0x87,0x6b, 0xc3,0x93,0x7b, 0xd3,0xa3,0x8b, 0xe3,0xb3,0x97,
+    0xab,0x8b,0xa3, 0x9f,0x7f,0x97, 0x93,0x73,0x87, 0x8b,0x67,0x7b, 0x7f,0x5b,0x6f, 0x77,0x53,0x63, 0x6b,0x4b,0x57, 0x5f,0x3f,0x4b,
+    0x57,0x37,0x43, 0x4b,0x2f,0x37, 0x43,0x27,0x2f, 0x37,0x1f,0x23, 0x2b,0x17,0x1b, 0x23,0x13,0x13, 0x17,0x0b,0x0b, 0x0f,0x07,0x07,
+    0xbb,0x73,0x9f, 0xaf,0x6b,0x8f, 0xa3,0x5f,0x83, 0x97,0x57,0x77, 0x8b,0x4f,0x6b, 0x7f,0x4b,0x5f, 0x73,0x43,0x53, 0x6b,0x3b,0x4b,
+    0x5f,0x33,0x3f, 0x53,0x2b,0x37, 0x47,0x23,0x2b, 0x3b,0x1f,0x23, 0x2f,0x17,0x1b, 0x23,0x13,0x13, 0x17,0x0b,0x0b, 0x0f,0x07,0x07,
+    0xdb,0xc3,0xbb, 0xcb,0xb3,0xa7, 0xbf,0xa3,0x9b, 0xaf,0x97,0x8b, 0xa3,0x87,0x7b, 0x97,0x7b,0x6f, 0x87,0x6f,0x5f, 0x7b,0x63,0x53,
+    0x6b,0x57,0x47, 0x5f,0x4b,0x3b, 0x53,0x3f,0x33, 0x43,0x33,0x27, 0x37,0x2b,0x1f, 0x27,0x1f,0x17, 0x1b,0x13,0x0f, 0x0f,0x0b,0x07,
+    0x6f,0x83,0x7b, 0x67,0x7b,0x6f, 0x5f,0x73,0x67, 0x57,0x6b,0x5f, 0x4f,0x63,0x57, 0x47,0x5b,0x4f, 0x3f,0x53,0x47, 0x37,0x4b,0x3f,
+    0x2f,0x43,0x37, 0x2b,0x3b,0x2f, 0x23,0x33,0x27, 0x1f,0x2b,0x1f, 0x17,0x23,0x17, 0x0f,0x1b,0x13, 0x0b,0x13,0x0b, 0x07,0x0b,0x07,
+    0xff,0xf3,0x1b, 0xef,0xdf,0x17, 0xdb,0xcb,0x13, 0xcb,0xb7,0x0f, 0xbb,0xa7,0x0f, 0xab,0x97,0x0b, 0x9b,0x83,0x07, 0x8b,0x73,0x07,
+    0x7b,0x63,0x07, 0x6b,0x53,0x00, 0x5b,0x47,0x00, 0x4b,0x37,0x00, 0x3b,0x2b,0x00, 0x2b,0x1f,0x00, 0x1b,0x0f,0x00, 0x0b,0x07,0x00,
+    0x00,0x00,0xff, 0x0b,0x0b,0xef, 0x13,0x13,0xdf, 0x1b,0x1b,0xcf, 0x23,0x23,0xbf, 0x2b,0x2b,0xaf, 0x2f,0x2f,0x9f, 0x2f,0x2f,0x8f,
+    0x2f,0x2f,0x7f, 0x2f,0x2f,0x6f, 0x2f,0x2f,0x5f, 0x2b,0x2b,0x4f, 0x23,0x23,0x3f, 0x1b,0x1b,0x2f, 0x13,0x13,0x1f, 0x0b,0x0b,0x0f,
+    0x2b,0x00,0x00, 0x3b,0x00,0x00, 0x4b,0x07,0x00, 0x5f,0x07,0x00, 0x6f,0x0f,0x00, 0x7f,0x17,0x07, 0x93,0x1f,0x07, 0xa3,0x27,0x0b,
+    0xb7,0x33,0x0f, 0xc3,0x4b,0x1b, 0xcf,0x63,0x2b, 0xdb,0x7f,0x3b, 0xe3,0x97,0x4f, 0xe7,0xab,0x5f, 0xef,0xbf,0x77, 0xf7,0xd3,0x8b,
+    0xa7,0x7b,0x3b, 0xb7,0x9b,0x37, 0xc7,0xc3,0x37, 0xe7,0xe3,0x57, 0x7f,0xbf,0xff, 0xab,0xe7,0xff, 0xd7,0xff,0xff, 0x67,0x00,0x00,
+    0x8b,0x00,0x00, 0xb3,0x00,0x00, 0xd7,0x00,0x00, 0xff,0x00,0x00, 0xff,0xf3,0x93, 0xff,0xf7,0xc7, 0xff,0xff,0xff, 0x9f,0x5b,0x53
+};
+
+// LoadPalette: Replaces the built-in palette with a palette.lmp (256 RGB triples).
+void LoadPalette (char *filename)
+{
+    FILE *f = SafeOpenRead(filename);
+    int length = filelength(f);
+    if (length != (int)sizeof(loaded_palette))
+        Error("%s is not a palette: expected %zu bytes, found %d.", filename, sizeof(loaded_palette), length);
+    SafeRead(f, loaded_palette, length);
+    fclose(f);
+}
+
+
+// --- Model ---
+// libmdl builds a table of all frames (group sub-frames get an entry each), so
+// frames can be decoded independently and in parallel. A converted model refers
+// to the parsed mdl_t and keeps its own, possibly filtered, view of the frames.
+typedef struct mdlmodel_s mdlmodel_t;
+typedef struct resample_s resample_t;
+
+// --- Output Backends ---
+// Every output format is a backend. The model is parsed once, each frame is
+// decoded once, on its frame thread, into one decodedframe_t that all backends
+// share, and every enabled backend is handed the model in turn:
+//   begin   after the mesh and frame table are ready, on the model's thread; returns its state
+//   skin    for every skin in the skin table, on the model's thread
+//   frame   for every frame, on the frame threads: in any order, and concurrently
+//   end     after the last frame, on the model's thread
+// Any of them may be NULL. A frame call gets framearena bytes of scratch from its
+// thread's arena; state allocated in begin comes from the worker arena and lives
+// until the model is finished.
+#define MAX_BACKENDS    4
+
+typedef struct {
+    const char  *name;      // As given to --format
+    size_t      (*framearena) (const mdlmodel_t *model);
+    void        *(*begin) (worker_t *w, mdlmodel_t *model);
+    void        (*skin) (worker_t *w, mdlmodel_t *model, void *state, int index);
+    void        (*frame) (const mdlmodel_t *model, void *state, int index, const decodedframe_t *frame,
+                          arena_t *arena, stats_t *stats);
+    void        (*end) (worker_t *w, mdlmodel_t *model, void *state);
+} outputbackend_t;
+
+struct mdlmodel_s {
+    mdl_header_t        header;
+    const mdl_t         *mdl;       // The parsed model (st_verts, triangles, frames)
+    const stvert_t      *st_verts;
+    const dtriangle_t   *triangles;
+    const float         *uvs;       // u, v of every triangle corner (MDL_BuildUVTable)
+    mdlframe_t          *frames;
+    int                 numframes;  // Entries in frames
+    char                *outbase;   // Output file name prefix
+    pakfile_t           *pak;       // Container receiving the outputs, or NULL
+    outputcache_t       *cache;     // Manifest for --incremental, or NULL
+    writebatch_t        *writes;    // Batch for the output queue, or NULL to write directly
+    const outputbackend_t *backends[MAX_BACKENDS + 1]; // The model's backends (the skin writer, then the frame formats)
+    void                *backendstate[MAX_BACKENDS + 1];
+    int                 numbackends;
+    const resample_t    *resample;  // With --resample: the source frames behind frames, or NULL
+};
+
+// SaveOutput: Writes one finished output file, either as a loose file (through
+// the output queue when there is one), into the model's container, or as a
+// member of the tar stream on stdout.
+void SaveOutput (const mdlmodel_t *model, outputkind_t kind, int index, char *filename, const byte *data, size_t len)
+{
+    if (output_stdout)
+        WriteTarEntry(stdout, filename, data, len);
+    else if (model->pak && (kind != OUTPUT_SKIN || output_container_skins))
+        AddToPak(model->pak, kind, index, filename, data, len);
+    else if (model->cache && CacheOutput(model->cache, filename, data, len))
+        return;
+    else if (model->writes)
+        QueueOutput(&write_queue, model->writes, filename, data, len);
+    else {
+        FILE *f = SafeOpenOutput(filename);
+        SafeWrite(f, (void *)data, (int)len);
+        if (fclose(f) != 0)
+            Error("Error writing %s: %s", filename, strerror(errno));
+    }
+}
+
+// ArenaModelAlloc: libmdl allocator callback that serves the model's tables from
+// a worker arena; they are released with the arena, so there is no free.
+void *ArenaModelAlloc (void *opaque, size_t size)
+{
+    return ArenaAlloc((arena_t *)opaque, size);
+}
+
+// SetModel: Points a model at the header, mesh and frame table of a parsed mdl_t.
+void SetModel (mdlmodel_t *model, const mdl_t *mdl)
+{
+    model->mdl = mdl;
+    model->header = mdl->header;
+    model->st_verts = mdl->st_verts;
+    model->triangles = mdl->triangles;
+    model->frames = mdl->frames;
+    model->numframes = mdl->numframes;
+}
+
+// FrameFileName: Builds the .tri name for a frame:
+// base_frame<i>.tri for single frames, base_frame<group_start_idx>_sub<sub_frame_idx>.tri for group frames.
+void FrameFileName (const mdlmodel_t *model, const mdlframe_t *frame, char *out, size_t size)
+{
+    int n;
+    if (frame->sub < 0)
+        n = snprintf(out, size, "%s_frame%d.tri", model->outbase, frame->group);
+    else
+        n = snprintf(out, size, "%s_frame%d_sub%d.tri", model->outbase, frame->group, frame->sub);
+    if (n < 0 || (size_t)n >= size)
+        Error("Output name for frame %d of %s is too long.", frame->group, model->outbase);
+}
+
+// SkinFileName: Builds the name of a skin output, like FrameFileName:
+// base_skin<i><suffix>.<ext> for single skins, base_skin<i>_sub<j><suffix>.<ext> for group skins.
+void SkinFileName (const mdlmodel_t *model, const mdlskin_t *skin, const char *suffix, char *out, size_t size)
+{
+    int n;
+    if (skin->sub < 0)
+        n = snprintf(out, size, "%s_skin%d%s.%s", model->outbase, skin->group, suffix, skin_extensions[skin_format]);
+    else
+        n = snprintf(out, size, "%s_skin%d_sub%d%s.%s", model->outbase, skin->group, skin->sub, suffix, skin_extensions[skin_format]);
+    if (n < 0 || (size_t)n >= size)
+        Error("Output name for skin %d of %s is too long.", skin->group, model->outbase);
+}
+
+// --- Frame Selection ---
+// --frames and --frame-name pick frames from the table by index (the position in
+// the table, counting group sub-frames) and by name. Frames that are not picked
+// are dropped from the table before decoding. Their vertices are never touched,
+// so with a mapped file the pages holding them are not even read.
+#define MAX_FRAME_RANGES    64
+
+typedef struct {
+    int     first;
+    int     last;       // INT_MAX for an open range ("10-")
+} framerange_t;
+
+framerange_t    frame_ranges[MAX_FRAME_RANGES];
+int             num_frame_ranges;
+char            *frame_names;   // Comma-separated globs, or NULL for any name
+qboolean        extract_skins = true;
+qboolean        extract_frames = true;
+
+// ParseFrameRanges: Parses a list such as "0,5-10,20-" into frame_ranges.
+void ParseFrameRanges (char *text)
+{
+    char *p = text;
+    while (*p) {
+        char *end;
+        if (num_frame_ranges == MAX_FRAME_RANGES)
+            Error("Too many frame ranges in \"%s\" (at most %d).", text, MAX_FRAME_RANGES);
+        framerange_t *r = &frame_ranges[num_frame_ranges++];
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first > INT_MAX)
+            Error("Bad frame range list \"%s\".", text);
+        r->first = r->last = (int)first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            if (*p == ',' || !*p) {
+                r->last = INT_MAX;
+            } else {
+                long last = strtol(p, &end, 10);
+                if (end == p || last < first || last > INT_MAX)
+                    Error("Bad frame range list \"%s\".", text);
+                r->last = (int)last;
+                p = end;
+            }
+        }
+        if (*p == ',')
+            p++;
+        else if (*p)
+            Error("Bad frame range list \"%s\".", text);
+    }
+}
+
+// GlobMatch: Matches name against a pattern of at most len characters, where
+// '*' matches any run of characters and '?' any one character.
+qboolean GlobMatch (const char *pattern, size_t len, const char *name)
+{
+    const char *star = NULL, *resume = NULL;
+    const char *end = pattern + len;
+    while (*name) {
+        if (pattern < end && (*pattern == '?' || *pattern == *name)) {
+            pattern++;
+            name++;
+        } else if (pattern < end && *pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (pattern < end && *pattern == '*')
+        pattern++;
+    return pattern == end;
+}
+
+// FrameSelected: Whether table entry index passes --frames and --frame-name.
+qboolean FrameSelected (int index, const mdlframe_t *frame)
+{
+    if (num_frame_ranges) {
+        int i;
+        for (i = 0; i < num_frame_ranges; i++) {
+            if (index >= frame_ranges[i].first && index <= frame_ranges[i].last)
+                break;
+        }
+        if (i == num_frame_ranges)
+            return false;
+    }
+    if (frame_names) {
+        for (const char *p = frame_names; ; p++) {
+            size_t len = strcspn(p, ",");
+            if (GlobMatch(p, len, frame->name))
+                return true;
+            p += len;
+            if (!*p)
+                return false;
+        }
+    }
+    return true;
+}
+
+// SelectFrames: Compacts the frame table down to the selected frames, and values
+// (one per frame, or NULL) along with it.
+void SelectFrames (mdlmodel_t *model, float *values)
+{
+    int count = 0;
+    if (!num_frame_ranges && !frame_names)
+        return;
+    for (int f = 0; f < model->numframes; f++) {
+        if (FrameSelected(f, &model->frames[f])) {
+            if (values)
+                values[count] = values[f];
+            model->frames[count++] = model->frames[f];
+        }
+    }
+    model->numframes = count;
+}
+
+// --- Frame Decoding ---
+// A frame is decoded in two steps: libmdl dequantizes every trivertx_t exactly once
+// into structure-of-arrays float buffers, then the triangle soup is gathered from
+// those through triangles_indices. The decoded buffers are what output writers work from.
+
+normalmode_t normal_mode = NORMALS_TABLE;   // --normals
+
+// AllocFrame: Points out at SoA buffers from arena for the positions, and the
+// normals unless they are turned off.
+void AllocFrame (const mdlmodel_t *model, arena_t *arena, decodedframe_t *out)
+{
+    int numverts = model->header.numverts;
+    int planes = normal_mode == NORMALS_NONE ? 3 : 6;
+    float *soa = (float *)ArenaAlloc(arena, planes * (size_t)numverts * sizeof(float));
+
+    out->numverts = numverts;
+    out->x = soa;
+    out->y = soa + numverts;
+    out->z = soa + 2 * numverts;
+    out->nx = out->ny = out->nz = NULL;
+    if (planes == 6) {
+        out->nx = soa + 3 * numverts;
+        out->ny = soa + 4 * numverts;
+        out->nz = soa + 5 * numverts;
+    }
+    out->raw = NULL;
+}
+
+// DecodeFrame: Dequantizes all vertices of a frame, and their normals unless they
+// are turned off, into SoA buffers from arena.
+void DecodeFrame (const mdlmodel_t *model, const mdlframe_t *frame, arena_t *arena, decodedframe_t *out)
+{
+    const mdl_header_t *header = &model->header;
+    AllocFrame(model, arena, out);
+    out->raw = MDL_FrameVerts(model->mdl, frame);
+    MDL_DequantizeVerts(out->raw, out->numverts, header->scale, header->scale_origin, out->x, out->y, out->z);
+    MDL_DecodeNormals(model->mdl, normal_mode, out);
+}
+
+// GatherTriangles: Builds the triangle soup for a decoded frame from triangles_indices.
+void GatherTriangles (const mdlmodel_t *model, const decodedframe_t *frame, tf_triangle *out)
+{
+    const dtriangle_t *tris = model->triangles;
+    const float *uv = model->uvs;
+    for (int t = 0; t < model->header.numtris; t++) {
+        for (int v_idx = 0; v_idx < 3; v_idx++, uv += 2) { // Loop 3 times for each vertex of the triangle
+            int vert_index = tris[t].vertindex[v_idx];
+            aliaspoint_t *pt = &out[t].pt[v_idx];
+            pt->p[0] = frame->x[vert_index];
+            pt->p[1] = frame->y[vert_index];
+            pt->p[2] = frame->z[vert_index];
+            if (frame->nx) {
+                pt->n[0] = frame->nx[vert_index];
+                pt->n[1] = frame->ny[vert_index];
+                pt->n[2] = frame->nz[vert_index];
+            } else {
+                pt->n[0] = pt->n[1] = pt->n[2] = 0;
+            }
+            pt->c[0] = pt->c[1] = pt->c[2] = 0;
+            pt->u = uv[0];
+            pt->v = uv[1];
+        }
+    }
+}
+
+// --- .tri Backend ---
+// One Alias .tri file per frame: the triangle soup is gathered from the decoded
+// frame through the triangle indices and the UV table, then byte-swapped into
+// the file in one pass.
+
+size_t TriFrameArenaSize (const mdlmodel_t *model)
+{
+    return ArenaRound((size_t)model->header.numtris * sizeof(tf_triangle))
+         + ArenaRound(TriFileSize(model->header.numtris));
+}
+
+void TriFrame (const mdlmodel_t *model, void *state, int index, const decodedframe_t *frame, arena_t *arena, stats_t *stats)
+{
+    (void)state;
+    double start = I_FloatTime();
+    tf_triangle *triangles = (tf_triangle *)ArenaAlloc(arena, model->header.numtris * sizeof(tf_triangle));
+    GatherTriangles(model, frame, triangles);
+
+    byte *buffer = (byte *)ArenaAlloc(arena, TriFileSize(model->header.numtris));
+    size_t len = BuildTriFile(buffer, triangles, model->header.numtris);
+
+    char frame_filename[1024];
+    FrameFileName(model, &model->frames[index], frame_filename, sizeof(frame_filename));
+    SaveOutput(model, OUTPUT_FRAME, index, frame_filename, buffer, len);
+    AddPhase(stats, PHASE_WRITE, start, len);
+}
+
+void TriEnd (worker_t *w, mdlmodel_t *model, void *state)
+{
+    (void)state;
+    Log(w, "  Saved %d frames as .tri files\n", model->numframes);
+    for (int f = 0; verbose && f < model->numframes; f++) {
+        const mdlframe_t *frame = &model->frames[f];
+        char frame_filename[1024];
+        FrameFileName(model, frame, frame_filename, sizeof(frame_filename));
+        if (frame->sub < 0)
+            Log(w, "  Saved frame %d ('%s') to %s\n", frame->group, frame->name, frame_filename);
+        else
+            Log(w, "  Saved group frame %d (sub-frame %d '%s') to %s\n", frame->group, frame->sub, frame->name, frame_filename);
+    }
+}
+
+const outputbackend_t tri_backend = { "tri", TriFrameArenaSize, NULL, NULL, TriFrame, TriEnd };
+
+
+// ExtractFrame: Decodes one frame and hands it to every backend of the model.
+void ExtractFrame (const mdlmodel_t *model, int index, arena_t *arena, stats_t *stats)
+{
+    const mdlframe_t *frame = &model->frames[index];
+    decodedframe_t decoded;
+    double start = I_FloatTime();
+
+    ArenaReset(arena);
+    DecodeFrame(model, frame, arena, &decoded);
+    AddPhase(stats, PHASE_DECODE, start, sizeof(daliasframe_t) + (size_t)model->header.numverts * sizeof(trivertx_t));
+
+    for (int i = 0; i < model->numbackends; i++) {
+        if (model->backends[i]->frame)
+            model->backends[i]->frame(model, model->backendstate[i], index, &decoded, arena, stats);
+    }
+}
+
+// FrameArenaSize: Arena space one frame thread needs: the decoded frames, and the
+// scratch of every backend.
+size_t FrameArenaSize (const mdlmodel_t *model)
+{
+    // --resample holds two source frames and the blend of them
+    size_t size = ArenaRound(6 * (size_t)model->header.numverts * sizeof(float)) * (model->resample ? 3 : 1);
+    for (int i = 0; i < model->numbackends; i++) {
+        if (model->backends[i]->framearena)
+            size += model->backends[i]->framearena(model);
+    }
+    return size;
+}
+
+// --- Resampling ---
+// --resample HZ replaces the frame table with frames at a fixed rate, for vertex
+// caches. Every frame of the (selected) table is a key at the time it starts:
+// single frames last 0.1 s, the rate the Quake engine steps them at, and group
+// sub-frames last until their time in the group's interval table. An output frame
+// at time k / HZ blends the two keys around it linearly. The frame threads work
+// on one pair of keys (a segment) at a time: both are decoded once, every output
+// frame between them is blended and handed to the backends, and nothing else is
+// kept, so the decoding does not grow with the length of the animation. Only the
+// tri backend writes each frame straight out; glb assembles one file holding every
+// morph target, so its buffer still grows with the number of output frames.
+#define DEFAULT_FRAME_TIME  0.1f    // Single frames, and intervals that do not advance
+
+float resample_rate;    // --resample: output frames per second, 0 for the frame table as is
+
+struct resample_s {
+    mdlframe_t  *keys;          // The source frames
+    int         numkeys;
+    float       *times;         // Start time of every key
+    int         *first;         // First output frame of every segment, and numframes after the last
+    int         numsegments;    // numkeys - 1, or 1 for a single key
+};
+
+// FrameDurations: The time each frame of the table lasts, from the interval
+// tables; the table must not be filtered yet, since a group sub-frame starts when
+// the one before it ends.
+float *FrameDurations (const mdlmodel_t *model, arena_t *arena)
+{
+    float *durations = (float *)ArenaAlloc(arena, (size_t)model->numframes * sizeof(float));
+    for (int f = 0; f < model->numframes; f++) {
+        const mdlframe_t *frame = &model->frames[f];
+        float d = DEFAULT_FRAME_TIME;
+        if (frame->sub >= 0)
+            d = frame->interval - (frame->sub > 0 ? model->frames[f - 1].interval : 0);
+        durations[f] = d > 0 ? d : DEFAULT_FRAME_TIME;
+    }
+    return durations;
+}
+
+// BuildResample: Lays the model's frames out on a timeline and replaces the frame
+// table with the output frames: frame k is named after the key it starts from and
+// records its end time as its interval.
+void BuildResample (worker_t *w, mdlmodel_t *model, const float *durations, resample_t *r)
+{
+    int numkeys = model->numframes;
+    if (numkeys < 1)
+        return;
+    r->keys = model->frames;
+    r->numkeys = numkeys;
+    r->numsegments = numkeys > 1 ? numkeys - 1 : 1;
+    r->times = (float *)ArenaAlloc(&w->arena, (size_t)numkeys * sizeof(float));
+    r->first = (int *)ArenaAlloc(&w->arena, ((size_t)r->numsegments + 1) * sizeof(int));
+    r->times[0] = 0;
+    for (int i = 1; i < numkeys; i++)
+        r->times[i] = r->times[i - 1] + durations[i - 1];
+
+    // The last output frame falls on or just before the last key
+    double length = r->times[numkeys - 1];
+    double count = floor(length * resample_rate + 1e-4) + 1;
+    if (count > 1000000)
+        Error("%.3f s at %g Hz would make %.0f frames (at most 1000000).", length, resample_rate, count);
+    int numframes = (int)count;
+    mdlframe_t *frames = (mdlframe_t *)ArenaAlloc(&w->arena, (size_t)numframes * sizeof(mdlframe_t));
+
+    int segment = 0;
+    r->first[0] = 0;
+    for (int k = 0; k < numframes; k++) {
+        double t = k / (double)resample_rate;
+        while (segment + 1 < r->numsegments && t >= r->times[segment + 1] - 1e-6) {
+            r->first[++segment] = k;
+        }
+        const mdlframe_t *key = &r->keys[segment];
+        mdlframe_t *frame = &frames[k];
+        *frame = *key;
+        frame->type = ALIAS_SINGLE;
+        frame->group = k;
+        frame->sub = -1;
+        frame->interval = (float)((k + 1) / (double)resample_rate);
+        // Keep the names unique for importers: the key's name and the frame number
+        char number[16];
+        int n = snprintf(number, sizeof(number), "_%d", k);
+        snprintf(frame->name, sizeof(frame->name), "%.*s%s", (int)(sizeof(frame->name) - 1 - n), key->name, number);
+    }
+    while (segment < r->numsegments)
+        r->first[++segment] = numframes;
+
+    model->frames = frames;
+    model->numframes = numframes;
+    model->resample = r;
+}
+
+// LerpPlane: out = a + (b - a) * t over count floats, 4 at a time with SSE or NEON.
+void LerpPlane (const float *a, const float *b, float t, float *out, int count)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    __m128 vt = _mm_set1_ps(t);
+    for ( ; i + 4 <= count; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), va), vt)));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t vt = vdupq_n_f32(t);
+    for ( ; i + 4 <= count; i += 4) {
+        float32x4_t va = vld1q_f32(a + i);
+        vst1q_f32(out + i, vmlaq_f32(va, vsubq_f32(vld1q_f32(b + i), va), vt));
+    }
+#endif
+    for ( ; i < count; i++)
+        out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+// LerpFrame: Blends two decoded frames. Normals are blended and renormalized; one
+// that cancels out keeps the first frame's normal.
+void LerpFrame (const decodedframe_t *a, const decodedframe_t *b, float t, decodedframe_t *out)
+{
+    int n = a->numverts;
+    LerpPlane(a->x, b->x, t, out->x, n);
+    LerpPlane(a->y, b->y, t, out->y, n);
+    LerpPlane(a->z, b->z, t, out->z, n);
+    out->raw = t < 0.5f ? a->raw : b->raw;
+    if (!out->nx)
+        return;
+    LerpPlane(a->nx, b->nx, t, out->nx, n);
+    LerpPlane(a->ny, b->ny, t, out->ny, n);
+    LerpPlane(a->nz, b->nz, t, out->nz, n);
+    for (int v = 0; v < n; v++) {
+        float len = out->nx[v] * out->nx[v] + out->ny[v] * out->ny[v] + out->nz[v] * out->nz[v];
+        if (len > 1e-12f) {
+            len = 1.0f / sqrtf(len);
+            out->nx[v] *= len;
+            out->ny[v] *= len;
+            out->nz[v] *= len;
+        } else {
+            out->nx[v] = a->nx[v];
+            out->ny[v] = a->ny[v];
+            out->nz[v] = a->nz[v];
+        }
+    }
+}
+
+// ResampleSegment: Decodes the two keys of a segment and hands every output frame
+// between them to the model's backends.
+void ResampleSegment (const mdlmodel_t *model, int segment, arena_t *arena, stats_t *stats)
+{
+    const resample_t *r = model->resample;
+    int a = segment, b = segment + 1 < r->numkeys ? segment + 1 : segment;
+    size_t framebytes = sizeof(daliasframe_t) + (size_t)model->header.numverts * sizeof(trivertx_t);
+    decodedframe_t keys[2], out;
+    double start = I_FloatTime();
+
+    ArenaReset(arena);
+    DecodeFrame(model, &r->keys[a], arena, &keys[0]);
+    if (b != a)
+        DecodeFrame(model, &r->keys[b], arena, &keys[1]);
+    else
+        keys[1] = keys[0];
+    AllocFrame(model, arena, &out);
+    AddPhase(stats, PHASE_DECODE, start, framebytes * (1 + (b != a)));
+
+    float span = r->times[b] - r->times[a];
+    for (int k = r->first[segment]; k < r->first[segment + 1]; k++) {
+        start = I_FloatTime();
+        float t = span > 0 ? (float)((k / (double)resample_rate - r->times[a]) / span) : 0;
+        // Frames that fall on a key are the key, exactly as without --resample
+        decodedframe_t *frame = &out;
+        if (t <= 1e-5f)
+            frame = &keys[0];
+        else if (t >= 1 - 1e-5f)
+            frame = &keys[1];
+        else
+            LerpFrame(&keys[0], &keys[1], t, &out);
+        AddPhase(stats, PHASE_DECODE, start, 0);
+
+        size_t mark = arena->used;
+        for (int i = 0; i < model->numbackends; i++) {
+            if (model->backends[i]->frame)
+                model->backends[i]->frame(model, model->backendstate[i], k, frame, arena, stats);
+            arena->used = mark;
+        }
+    }
+}
+
+typedef struct {
+    worker_t        *w;
+    mdlmodel_t      *model;
+    int             failed;
+    char            message[1024];
+    pthread_mutex_t lock;
+} framejob_t;
+
+// ExtractFrameWork: RunThreadsOn callback. Errors are caught per frame and handed
+// back to ExtractFrames, since frame threads have no conversion handler of their own.
+void ExtractFrameWork (int threadnum, int work, void *arg)
+{
+    framejob_t *job = (framejob_t *)arg;
+    jmp_buf env;
+    jmp_buf *saved_jmp = error_jmp;
+    stats_t stats;
+
+    memset(&stats, 0, sizeof(stats));
+    if (setjmp(env) == 0) {
+        error_jmp = &env;
+        if (job->model->resample)
+            ResampleSegment(job->model, work, &job->w->framearenas[threadnum], &stats);
+        else
+            ExtractFrame(job->model, work, &job->w->framearenas[threadnum], &stats);
+        pthread_mutex_lock(&job->lock);
+        AddStats(&job->w->stats, &stats);
+        pthread_mutex_unlock(&job->lock);
+    } else {
+        pthread_mutex_lock(&job->lock);
+        if (!job->failed) {
+            job->failed = 1;
+            snprintf(job->message, sizeof(job->message), "%s", error_message);
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+    error_jmp = saved_jmp;
+}
+
+// ExtractFrames: Decodes every frame in the table for the model's backends, using
+// up to framethreads threads.
+void ExtractFrames (worker_t *w, mdlmodel_t *model)
+{
+    // With --resample every thread works on a segment between two source frames
+    int count = model->resample ? model->resample->numsegments : model->numframes;
+    int threads = framethreads > 0 ? framethreads : 1;
+    if (threads > count)
+        threads = count;
+    if (threads < 1)
+        return;
+
+    // Under --max-memory, run only as many frame threads as there is room for
+    // arenas; with one, every frame streams through the same decode and output
+    // buffers. Arenas beyond that are released so they do not count.
+    size_t framesize = FrameArenaSize(model);
+    if (max_memory) {
+        size_t held = w->memory;
+        for (int i = 0; i < w->numframearenas; i++)
+            held -= w->framearenas[i].size;
+        size_t room = held < max_memory ? max_memory - held : 0;
+        if (room < framesize)
+            Error("%s: frames need %zu bytes of buffers; %zu of --max-memory %zu are left.",
+                  model->outbase, framesize, room, max_memory);
+        if ((size_t)threads > room / framesize) {
+            threads = (int)(room / framesize);
+            Log(w, "  --max-memory: decoding with %d frame thread%s\n", threads, threads == 1 ? "" : "s");
+        }
+        for (int i = threads; i < w->numframearenas; i++)
+            FreeArena(&w->framearenas[i]);
+    }
+
+    if (w->numframearenas < threads) {
+        arena_t *a = (arena_t *)CountedRealloc(w->framearenas, threads * sizeof(arena_t));
+        if (!a)
+            Error("Failed to allocate frame arenas.");
+        w->allocations++;
+        memset(a + w->numframearenas, 0, (threads - w->numframearenas) * sizeof(arena_t));
+        for (int i = w->numframearenas; i < threads; i++)
+            a[i].memory = &w->memory;
+        w->framearenas = a;
+        w->numframearenas = threads;
+    }
+    // Size every frame arena once, before any thread starts using it
+    for (int i = 0; i < threads; i++)
+        ArenaReserve(&w->framearenas[i], framesize);
+
+    framejob_t job;
+    job.w = w;
+    job.model = model;
+    job.failed = 0;
+    job.message[0] = '\0';
+    pthread_mutex_init(&job.lock, NULL);
+    RunThreadsOn(count, threads, ExtractFrameWork, &job);
+    pthread_mutex_destroy(&job.lock);
+
+    if (job.failed)
+        Error("%s", job.message);
+}
+
+
+// --- Delta Animation Output ---
+// --mda writes all frames of a model into one <base>.mda instead of a .tri per
+// frame: the triangle indices once, then the quantized trivertx_t bytes of the
+// first frame, then each later frame as the byte-wise difference from the one
+// before it. Vertices move little between frames, so the differences are mostly
+// zero; with --mda=rle every plane is ByteRun1 coded. The bytes are exact, so a
+// reader dequantizes the same positions the .tri path writes. See mda_INFO.md.
+#define IDMDAHEADER     (('1'<<24)+('A'<<16)+('D'<<8)+'M') // Little-endian "MDA1"
+#define MDA_VERSION     1
+#define MDA_RLE         1   // Frame planes are ByteRun1 coded
+
+qboolean output_mda_rle;    // --mda=rle
+
+// MDAFileSize: Upper bound on the size of the .mda file BuildMDAFile produces.
+size_t MDAFileSize (const mdlmodel_t *model)
+{
+    size_t numverts = model->header.numverts;
+    size_t plane = numverts + (numverts + 127) / 128;   // ByteRun1 worst case
+    return 48 + (size_t)model->header.numtris * 3 * 2 + (size_t)model->numframes * (16 + 4 + 4 * plane);
+}
+
+// BuildMDAFile: Builds the .mda file for the model's frame table in buffer
+// (MDAFileSize bytes), using planes (4 * numverts bytes) as scratch. Returns its length.
+size_t BuildMDAFile (byte *buffer, const mdlmodel_t *model, byte *planes, qboolean compress)
+{
+    const mdl_header_t *header = &model->header;
+    int numverts = header->numverts;
+    byte *out = buffer;
+    int i;
+
+    // Header: all fields little-endian, floats as their IEEE bits
+    int fields[6] = { IDMDAHEADER, MDA_VERSION, compress ? MDA_RLE : 0, numverts, header->numtris, model->numframes };
+    for (i = 0; i < 6; i++, out += 4)
+        WriteLittleLongToBuffer(out, (unsigned int)fields[i]);
+    for (i = 0; i < 6; i++, out += 4) {
+        unsigned int bits;
+        memcpy(&bits, i < 3 ? &header->scale[i] : &header->scale_origin[i - 3], 4);
+        WriteLittleLongToBuffer(out, bits);
+    }
+
+    // Shared index buffer
+    for (int t = 0; t < header->numtris; t++) {
+        for (int k = 0; k < 3; k++, out += 2) {
+            int index = model->triangles[t].vertindex[k];
+            out[0] = (byte)(index & 0xff);
+            out[1] = (byte)(index >> 8);
+        }
+    }
+
+    for (int f = 0; f < model->numframes; f++, out += 16)
+        memcpy(out, model->frames[f].name, 16);
+
+    // Frames: four planes (x, y, z, normal index) of numverts bytes each; the
+    // first frame is stored as is, later ones as the difference modulo 256
+    const trivertx_t *prev = NULL;
+    for (int f = 0; f < model->numframes; f++) {
+        const trivertx_t *cur = MDL_FrameVerts(model->mdl, &model->frames[f]);
+        for (int v = 0; v < numverts; v++) {
+            planes[v]                = (byte)(cur[v].v[0] - (prev ? prev[v].v[0] : 0));
+            planes[numverts + v]     = (byte)(cur[v].v[1] - (prev ? prev[v].v[1] : 0));
+            planes[2 * numverts + v] = (byte)(cur[v].v[2] - (prev ? prev[v].v[2] : 0));
+            planes[3 * numverts + v] = (byte)(cur[v].lightnormalindex - (prev ? prev[v].lightnormalindex : 0));
+        }
+        prev = cur;
+
+        byte *block = out + 4;
+        if (compress) {
+            byte *p = block;
+            for (int k = 0; k < 4; k++)
+                p += PackBitsRow(planes + (size_t)k * numverts, numverts, p);
+            out = p;
+        } else {
+            memcpy(block, planes, 4 * (size_t)numverts);
+            out = block + 4 * (size_t)numverts;
+        }
+        WriteLittleLongToBuffer(block - 4, (unsigned int)(out - block));
+    }
+    return out - buffer;
+}
+
+// ExtractAnimation: The backend's end call; writes the model's frame table as one
+// .mda file. It works from the quantized bytes, so it needs no frame calls.
+void ExtractAnimation (worker_t *w, mdlmodel_t *model, void *state)
+{
+    (void)state;
+    char filename[1024];
+    double start = I_FloatTime();
+    if (snprintf(filename, sizeof(filename), "%s.mda", model->outbase) >= (int)sizeof(filename))
+        Error("Output name %s.mda is too long.", model->outbase);
+    if (model->header.numverts > 65536)
+        Error("%d vertices do not fit the 16-bit .mda index buffer.", model->header.numverts);
+
+    size_t mark = w->arena.used;
+    byte *planes = (byte *)ArenaAlloc(&w->arena, 4 * (size_t)model->header.numverts);
+    byte *buffer = (byte *)ArenaAlloc(&w->arena, MDAFileSize(model));
+    size_t len = BuildMDAFile(buffer, model, planes, output_mda_rle);
+    SaveOutput(model, OUTPUT_ANIMATION, 0, filename, buffer, len);
+    w->arena.used = mark;
+    AddPhase(&w->stats, PHASE_WRITE, start, len);
+
+    Log(w, "  Saved %d frames to %s (%zu bytes, %zu as .tri files)\n", model->numframes, filename, len,
+        (size_t)model->numframes * TriFileSize(model->header.numtris));
+}
+
+const outputbackend_t mda_backend = { "mda", NULL, NULL, NULL, NULL, ExtractAnimation };
+
+
+// --- glTF Binary Output ---
+// --glb writes each model as one <base>.glb: a single indexed mesh with one UV
+// set, and every frame as a morph target (a shape key in Blender) named after
+// the frame. glTF keeps one UV per vertex, so an MDL vertex on the skin seam is
+// split in two when back-facing triangles use it; those see the back half of
+// the skin. The UVs come from the model's corner table. Positions are converted from Quake's Z-up axes to glTF's Y-up ones
+// (forward X becomes +Z, left Y becomes +X), and the winding is reversed, since
+// Quake's front faces are clockwise and glTF's are counter-clockwise. Frame data
+// goes straight from the dequantized SoA arrays into the binary chunk. Unless
+// --normals=none, the base shape has a NORMAL and every target a NORMAL
+// displacement as well.
+#define GLB_MAGIC           0x46546C67  // "glTF"
+#define GLB_CHUNK_JSON      0x4E4F534A  // "JSON"
+#define GLB_CHUNK_BIN       0x004E4942  // "BIN\0"
+#define GL_ARRAY_BUFFER     34962
+#define GL_ELEMENT_ARRAY_BUFFER 34963
+#define GL_UNSIGNED_SHORT   5123
+#define GL_UNSIGNED_INT     5125
+#define GL_FLOAT            5126
+
+typedef struct {
+    char    *text;
+    size_t  len;
+    size_t  size;
+} jsonbuf_t;
+
+// JSONPrintf: Appends to a JSON buffer sized up front by its writer.
+void JSONPrintf (jsonbuf_t *j, char *fmt, ...)
+{
+    va_list argptr;
+    va_start(argptr, fmt);
+    int n = vsnprintf(j->text + j->len, j->size - j->len, fmt, argptr);
+    va_end(argptr);
+    if (n < 0 || (size_t)n >= j->size - j->len)
+        Error("JSON output overflows its %zu byte buffer.", j->size);
+    j->len += n;
+}
+
+// JSONString: Appends s as a quoted JSON string (at most 6 bytes per character).
+void JSONString (jsonbuf_t *j, const char *s)
+{
+    JSONPrintf(j, "\"");
+    for ( ; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            JSONPrintf(j, "\\%c", c);
+        else if (c < 0x20 || c >= 0x7f)
+            JSONPrintf(j, "\\u%04x", c);  // Frame names are not UTF-8; keep the JSON valid
+        else
+            JSONPrintf(j, "%c", c);
+    }
+    JSONPrintf(j, "\"");
+}
+
+// GLBJSONSize: Upper bound on the JSON chunk for a model.
+size_t GLBJSONSize (const mdlmodel_t *model)
+{
+    return 4096 + 6 * strlen(model->outbase) + (size_t)model->numframes * (1024 + 6 * 16);
+}
+
+// GLBVector: Appends the min or max of an accessor as a JSON array.
+void GLBVector (jsonbuf_t *j, const char *key, const float *v)
+{
+    JSONPrintf(j, ", \"%s\": [%.9g, %.9g, %.9g]", key, v[0], v[1], v[2]);
+}
+
+// GLBBounds: The min and max of count glTF vectors.
+void GLBBounds (const float *v, int count, float *mins, float *maxs)
+{
+    mins[0] = mins[1] = mins[2] = 1e30f;
+    maxs[0] = maxs[1] = maxs[2] = -1e30f;
+    for (int i = 0; i < count; i++, v += 3) {
+        for (int k = 0; k < 3; k++) {
+            if (v[k] < mins[k])
+                mins[k] = v[k];
+            if (v[k] > maxs[k])
+                maxs[k] = v[k];
+        }
+    }
+}
+
+// GLBPositions: Writes the glTF positions (or normals) of one decoded frame.
+void GLBPositions (float *out, const float *x, const float *y, const float *z, const int *source, int count)
+{
+    for (int i = 0; i < count; i++, out += 3) {
+        int v = source[i];
+        out[0] = y[v];
+        out[1] = z[v];
+        out[2] = x[v];
+    }
+}
+
+// GLBDisplace: Turns count vectors into morph target displacements from base.
+void GLBDisplace (float *v, const float *base, int count)
+{
+    for (int i = 0; i < count * 3; i++)
+        v[i] -= base[i];
+}
+
+// The binary chunk holds the indices, the UVs, the base positions, one target
+// per frame, and the normals laid out the same way after the positions. Frame
+// calls write their frame's target straight into it, in place; the end call
+// turns the targets into displacements and writes the JSON in front.
+typedef struct {
+    size_t      mark;           // Worker arena position before the model's GLB state
+    int         *source;        // MDL vertex of every glTF vertex
+    int         count;          // glTF vertices
+    int         normals;
+    int         indexsize;
+    size_t      indexbytes, uvbytes, posbytes, binsize;
+    byte        *glb;
+    size_t      glbsize;
+    byte        *bin;           // The binary chunk, at the end of glb
+    float       *base;          // Base positions, followed by one target per frame
+    float       *nbase;         // The same for normals
+    float       (*bounds)[2][3]; // Of the base positions and of every target
+} glbstate_t;
+
+// GLBBegin: Splits the seam vertices, and writes the indices and UVs.
+void *GLBBegin (worker_t *w, mdlmodel_t *model)
+{
+    const mdl_header_t *header = &model->header;
+    int numverts = header->numverts, numtris = header->numtris, numframes = model->numframes;
+
+    double start = I_FloatTime();
+
+    if (numframes < 1 || numtris < 1)
+        Error("%s has no frames or triangles to export.", model->outbase);
+
+    size_t mark = w->arena.used;
+    glbstate_t *g = (glbstate_t *)ArenaAlloc(&w->arena, sizeof(glbstate_t));
+    memset(g, 0, sizeof(*g));
+    g->mark = mark;
+
+    // Split the vertices: key 2 * v is vertex v as the front, 2 * v + 1 as a
+    // back-facing triangle on the seam sees it
+    int *remap = (int *)ArenaAlloc(&w->arena, 2 * (size_t)numverts * sizeof(int));
+    int *source = (int *)ArenaAlloc(&w->arena, 2 * (size_t)numverts * sizeof(int));
+    int *corner = (int *)ArenaAlloc(&w->arena, 2 * (size_t)numverts * sizeof(int)); // First corner using it
+    int count = 0;
+    memset(remap, -1, 2 * (size_t)numverts * sizeof(int));
+    for (int t = 0; t < numtris; t++) {
+        for (int k = 0; k < 3; k++) {
+            int v = model->triangles[t].vertindex[k];
+            int key = 2 * v + (!model->triangles[t].facesfront && model->st_verts[v].onseam);
+            if (remap[key] < 0) {
+                remap[key] = count;
+                source[count] = v;
+                corner[count] = t * 3 + k;
+                count++;
+            }
+        }
+    }
+    g->source = source;
+    g->count = count;
+
+    g->normals = normal_mode != NORMALS_NONE;
+    g->indexsize = count > 65535 ? 4 : 2;
+    g->indexbytes = ((size_t)numtris * 3 * g->indexsize + 3) & ~(size_t)3;
+    g->uvbytes = (size_t)count * 2 * sizeof(float);
+    g->posbytes = (size_t)count * 3 * sizeof(float);
+    g->binsize = g->indexbytes + g->uvbytes + g->posbytes * (1 + (size_t)numframes) * (1 + g->normals);
+    if (g->binsize > 0x7fffffff)
+        Error("%s is too large for a GLB file (%zu bytes of vertex data).", model->outbase, g->binsize);
+
+    g->glbsize = 12 + 8 + ((GLBJSONSize(model) + 3) & ~(size_t)3) + 8 + g->binsize;  // Keeps the binary chunk 4-byte aligned
+    g->glb = (byte *)ArenaAlloc(&w->arena, g->glbsize);
+    g->bin = g->glb + g->glbsize - g->binsize;   // The JSON is written in front of it once its size is known
+
+    byte *p = g->bin;
+    for (int t = 0; t < numtris; t++) {
+        static const int order[3] = { 0, 2, 1 }; // Clockwise to counter-clockwise
+        for (int k = 0; k < 3; k++, p += g->indexsize) {
+            const dtriangle_t *tri = &model->triangles[t];
+            int v = tri->vertindex[order[k]];
+            unsigned int index = remap[2 * v + (!tri->facesfront && model->st_verts[v].onseam)];
+            if (g->indexsize == 4)
+                WriteLittleLongToBuffer(p, index);
+            else {
+                p[0] = (byte)(index & 0xff);
+                p[1] = (byte)(index >> 8);
+            }
+        }
+    }
+    memset(p, 0, g->bin + g->indexbytes - p);
+
+    float *uv = (float *)(g->bin + g->indexbytes);
+    for (int i = 0; i < count; i++) {
+        uv[i * 2] = model->uvs[corner[i] * 2];
+        uv[i * 2 + 1] = model->uvs[corner[i] * 2 + 1];
+    }
+
+    g->base = (float *)(g->bin + g->indexbytes + g->uvbytes);
+    g->nbase = g->base + (1 + (size_t)numframes) * count * 3;
+    g->bounds = (float (*)[2][3])ArenaAlloc(&w->arena, (1 + (size_t)numframes) * sizeof(*g->bounds));
+    AddPhase(&w->stats, PHASE_WRITE, start, 0);
+    return g;
+}
+
+// GLBFrame: Writes a frame's positions and normals as its target; frame 0 is
+// the base shape as well.
+void GLBFrame (const mdlmodel_t *model, void *state, int index, const decodedframe_t *frame, arena_t *arena, stats_t *stats)
+{
+    (void)model;
+    (void)arena;
+    glbstate_t *g = (glbstate_t *)state;
+    size_t stride = (size_t)g->count * 3;
+    double start = I_FloatTime();
+
+    float *target = g->base + (index + 1) * stride;
+    GLBPositions(target, frame->x, frame->y, frame->z, g->source, g->count);
+    if (index == 0)
+        memcpy(g->base, target, g->posbytes);
+    if (g->normals) {
+        float *ntarget = g->nbase + (index + 1) * stride;
+        GLBPositions(ntarget, frame->nx, frame->ny, frame->nz, g->source, g->count);
+        if (index == 0)
+            memcpy(g->nbase, ntarget, g->posbytes);
+    }
+    AddPhase(stats, PHASE_WRITE, start, 0);
+}
+
+// GLBEnd: Turns the targets into displacements, then writes the JSON chunk and
+// the .glb file.
+void GLBEnd (worker_t *w, mdlmodel_t *model, void *state)
+{
+    glbstate_t *g = (glbstate_t *)state;
+    int numtris = model->header.numtris, numframes = model->numframes, count = g->count;
+    int normals = g->normals, indexsize = g->indexsize;
+    size_t indexbytes = g->indexbytes, uvbytes = g->uvbytes, posbytes = g->posbytes, binsize = g->binsize;
+    size_t stride = (size_t)count * 3;
+    char filename[1024];
+    double start = I_FloatTime();
+
+    if (snprintf(filename, sizeof(filename), "%s.glb", model->outbase) >= (int)sizeof(filename))
+        Error("Output name %s.glb is too long.", model->outbase);
+
+    GLBBounds(g->base, count, g->bounds[0][0], g->bounds[0][1]);
+    for (int f = 0; f < numframes; f++) {
+        float *target = g->base + (f + 1) * stride;
+        GLBDisplace(target, g->base, count);
+        GLBBounds(target, count, g->bounds[f + 1][0], g->bounds[f + 1][1]);
+        if (normals)
+            GLBDisplace(g->nbase + (f + 1) * stride, g->nbase, count);
+    }
+
+    // JSON chunk: accessor 0 holds the indices, 1 the UVs, 2 the base positions
+    // and 3 + f the displacement of frame f, followed by the base normals at
+    // n = 3 + numframes and n + 1 + f the normal displacements of frame f; each
+    // accessor has its own bufferView
+    jsonbuf_t json;
+    json.size = (GLBJSONSize(model) + 3) & ~(size_t)3;
+    json.len = 0;
+    json.text = (char *)ArenaAlloc(&w->arena, json.size);
+    JSONPrintf(&json, "{\"asset\": {\"version\": \"2.0\", \"generator\": \"mdl2tri\"}, \"scene\": 0, "
+                      "\"scenes\": [{\"nodes\": [0]}], \"nodes\": [{\"name\": ");
+    JSONString(&json, model->outbase);
+    JSONPrintf(&json, ", \"mesh\": 0}], \"meshes\": [{\"name\": ");
+    JSONString(&json, model->outbase);
+    int n = 3 + numframes;
+    JSONPrintf(&json, ", \"primitives\": [{\"attributes\": {\"POSITION\": 2, \"TEXCOORD_0\": 1");
+    if (normals)
+        JSONPrintf(&json, ", \"NORMAL\": %d", n);
+    JSONPrintf(&json, "}, \"indices\": 0, \"targets\": [");
+    for (int f = 0; f < numframes; f++) {
+        JSONPrintf(&json, "%s{\"POSITION\": %d", f ? ", " : "", 3 + f);
+        if (normals)
+            JSONPrintf(&json, ", \"NORMAL\": %d", n + 1 + f);
+        JSONPrintf(&json, "}");
+    }
+    JSONPrintf(&json, "]}], \"weights\": [");
+    for (int f = 0; f < numframes; f++)
+        JSONPrintf(&json, "%s0", f ? ", " : "");
+    JSONPrintf(&json, "], \"extras\": {\"targetNames\": [");
+    for (int f = 0; f < numframes; f++) {
+        JSONPrintf(&json, f ? ", " : "");
+        JSONString(&json, model->frames[f].name);
+    }
+    JSONPrintf(&json, "]}}], \"buffers\": [{\"byteLength\": %zu}], \"bufferViews\": [", binsize);
+    JSONPrintf(&json, "{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": %zu, \"target\": %d}",
+               (size_t)numtris * 3 * indexsize, GL_ELEMENT_ARRAY_BUFFER);
+    JSONPrintf(&json, ", {\"buffer\": 0, \"byteOffset\": %zu, \"byteLength\": %zu, \"target\": %d}",
+               indexbytes, uvbytes, GL_ARRAY_BUFFER);
+    for (int f = 0; f <= numframes * (1 + normals) + normals; f++)
+        JSONPrintf(&json, ", {\"buffer\": 0, \"byteOffset\": %zu, \"byteLength\": %zu, \"target\": %d}",
+                   indexbytes + uvbytes + (size_t)f * posbytes, posbytes, GL_ARRAY_BUFFER);
+    JSONPrintf(&json, "], \"accessors\": [{\"bufferView\": 0, \"componentType\": %d, \"count\": %d, \"type\": \"SCALAR\"}",
+               indexsize == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, numtris * 3);
+    JSONPrintf(&json, ", {\"bufferView\": 1, \"componentType\": %d, \"count\": %d, \"type\": \"VEC2\"}", GL_FLOAT, count);
+    for (int f = 0; f <= numframes; f++) {
+        JSONPrintf(&json, ", {\"bufferView\": %d, \"componentType\": %d, \"count\": %d, \"type\": \"VEC3\"",
+                   2 + f, GL_FLOAT, count);
+        GLBVector(&json, "min", g->bounds[f][0]);
+        GLBVector(&json, "max", g->bounds[f][1]);
+        JSONPrintf(&json, "}");
+    }
+    for (int f = 0; normals && f <= numframes; f++)
+        JSONPrintf(&json, ", {\"bufferView\": %d, \"componentType\": %d, \"count\": %d, \"type\": \"VEC3\"}",
+                   n + f, GL_FLOAT, count);
+    JSONPrintf(&json, "]}");
+    while (json.len & 3)
+        json.text[json.len++] = ' ';    // Chunks are 4-byte aligned; JSON pads with spaces
+
+    // The UVs, positions and normals are host-order floats until now
+    MDL_LittleLongs(g->bin + indexbytes, g->bin + indexbytes, (binsize - indexbytes) / 4);
+
+    // Header and chunk headers, then the JSON moved down to sit just before the binary chunk
+    size_t total = 12 + 8 + json.len + 8 + binsize;
+    byte *out = g->bin - 8 - json.len - 8 - 12;
+    WriteLittleLongToBuffer(out, GLB_MAGIC);
+    WriteLittleLongToBuffer(out + 4, 2);
+    WriteLittleLongToBuffer(out + 8, (unsigned int)total);
+    WriteLittleLongToBuffer(out + 12, (unsigned int)json.len);
+    WriteLittleLongToBuffer(out + 16, GLB_CHUNK_JSON);
+    memcpy(out + 20, json.text, json.len);
+    WriteLittleLongToBuffer(out + 20 + json.len, (unsigned int)binsize);
+    WriteLittleLongToBuffer(out + 24 + json.len, GLB_CHUNK_BIN);
+
+    SaveOutput(model, OUTPUT_ANIMATION, 1, filename, out, total);
+    w->arena.used = g->mark;
+    AddPhase(&w->stats, PHASE_WRITE, start, total);
+
+    Log(w, "  Saved %d frames to %s (%d vertices after seam splits, %zu bytes, %zu as .tri files)\n",
+        numframes, filename, count, total, (size_t)numframes * TriFileSize(numtris));
+}
+
+const outputbackend_t glb_backend = { "glb", NULL, GLBBegin, NULL, GLBFrame, GLBEnd };
+
+
+// --- Frame Index Output ---
+// --index writes <base>.mdi, a table of every frame in the frame table: name,
+// group and sub-frame, group interval, the dequantized bounding box from its
+// daliasframe_t and the offset of that header in the model. Everything comes
+// from the frame headers libmdl already walked, so no vertex is read or decoded;
+// with the model mapped only the header pages are touched. --index=json writes
+// the same table as <base>_index.json. See mdi_INFO.md.
+#define IDMDIHEADER     (('1'<<24)+('I'<<16)+('D'<<8)+'M') // Little-endian "MDI1"
+#define MDI_VERSION     1
+#define MDI_HEADERSIZE  24
+#define MDI_ENTRYSIZE   56
+
+qboolean output_index_json; // --index=json
+
+// BuildMDIFile: Builds the .mdi file for the model's frame table in buffer
+// (MDI_HEADERSIZE + numframes * MDI_ENTRYSIZE bytes) and returns its length.
+size_t BuildMDIFile (byte *buffer, const mdlmodel_t *model)
+{
+    byte *out = buffer;
+    int i;
+
+    int fields[6] = { IDMDIHEADER, MDI_VERSION, model->numframes, MDI_ENTRYSIZE, model->header.synctype, model->header.flags };
+    for (i = 0; i < 6; i++, out += 4)
+        WriteLittleLongToBuffer(out, (unsigned int)fields[i]);
+
+    for (int f = 0; f < model->numframes; f++) {
+        const mdlframe_t *frame = &model->frames[f];
+        float values[7];
+        vec3_t mins, maxs;
+        MDL_FrameBounds(model->mdl, frame, mins, maxs);
+        values[0] = frame->interval;
+        for (i = 0; i < 3; i++) {
+            values[1 + i] = mins[i];
+            values[4 + i] = maxs[i];
+        }
+
+        memcpy(out, frame->name, 16);
+        WriteLittleLongToBuffer(out + 16, (unsigned int)frame->group);
+        WriteLittleLongToBuffer(out + 20, (unsigned int)frame->sub);
+        WriteLittleLongToBuffer(out + 24, (unsigned int)frame->offset);
+        out += 28;
+        for (i = 0; i < 7; i++, out += 4) {
+            unsigned int bits;
+            memcpy(&bits, &values[i], 4);
+            WriteLittleLongToBuffer(out, bits);
+        }
+    }
+    return out - buffer;
+}
+
+// IndexJSONSize: Upper bound on the JSON index of a model.
+size_t IndexJSONSize (const mdlmodel_t *model)
+{
+    return 256 + 6 * strlen(model->outbase) + (size_t)model->numframes * (256 + 6 * 16);
+}
+
+// BuildIndexJSON: The frame index as JSON, one frame per line.
+void BuildIndexJSON (jsonbuf_t *json, const mdlmodel_t *model)
+{
+    JSONPrintf(json, "{\"model\": ");
+    JSONString(json, model->outbase);
+    JSONPrintf(json, ", \"synctype\": %d, \"flags\": %d, \"frames\": [", model->header.synctype, model->header.flags);
+    for (int f = 0; f < model->numframes; f++) {
+        const mdlframe_t *frame = &model->frames[f];
+        vec3_t mins, maxs;
+        MDL_FrameBounds(model->mdl, frame, mins, maxs);
+        JSONPrintf(json, "%s\n  {\"name\": ", f ? "," : "");
+        JSONString(json, frame->name);
+        JSONPrintf(json, ", \"group\": %d, \"sub\": %d, \"interval\": %.9g, \"offset\": %zu",
+                   frame->group, frame->sub, frame->interval, frame->offset);
+        JSONPrintf(json, ", \"min\": [%.9g, %.9g, %.9g], \"max\": [%.9g, %.9g, %.9g]}",
+                   mins[0], mins[1], mins[2], maxs[0], maxs[1], maxs[2]);
+    }
+    JSONPrintf(json, "\n]}\n");
+}
+
+// WriteIndex: The index backend's end call. It needs no frame calls.
+void WriteIndex (worker_t *w, mdlmodel_t *model, void *state)
+{
+    (void)state;
+    char filename[1024];
+    double start = I_FloatTime();
+    size_t mark = w->arena.used;
+
+    if (snprintf(filename, sizeof(filename), "%s.mdi", model->outbase) >= (int)sizeof(filename))
+        Error("Output name %s.mdi is too long.", model->outbase);
+    byte *buffer = (byte *)ArenaAlloc(&w->arena, MDI_HEADERSIZE + (size_t)model->numframes * MDI_ENTRYSIZE);
+    size_t len = BuildMDIFile(buffer, model);
+    SaveOutput(model, OUTPUT_INDEX, 0, filename, buffer, len);
+    AddPhase(&w->stats, PHASE_WRITE, start, len);
+    Log(w, "  Indexed %d frames in %s (%zu bytes)\n", model->numframes, filename, len);
+
+    if (output_index_json) {
+        start = I_FloatTime();
+        if (snprintf(filename, sizeof(filename), "%s_index.json", model->outbase) >= (int)sizeof(filename))
+            Error("Output name %s_index.json is too long.", model->outbase);
+        jsonbuf_t json;
+        json.size = IndexJSONSize(model);
+        json.len = 0;
+        json.text = (char *)ArenaAlloc(&w->arena, json.size);
+        BuildIndexJSON(&json, model);
+        SaveOutput(model, OUTPUT_INDEX, 1, filename, (byte *)json.text, json.len);
+        AddPhase(&w->stats, PHASE_WRITE, start, json.len);
+        Log(w, "  Indexed %d frames in %s (%zu bytes)\n", model->numframes, filename, json.len);
+    }
+    w->arena.used = mark;
+}
+
+const outputbackend_t index_backend = { "index", NULL, NULL, NULL, NULL, WriteIndex };
+
+
+// --- Model Conversion ---
+char *stdin_name = "stdin"; // Output base name for a model read from stdin
+qboolean output_rle;        // --rle: ByteRun1-compress the LBM skin bodies
+
+// WriteSkin: The skin backend. Writes one skin of the skin table in the
+// --skin-format format, and with --fullbright its mask when it has any.
+void WriteSkin (worker_t *w, mdlmodel_t *model, void *state, int index)
+{
+    const mdl_t *mdl = model->mdl;
+    const mdlskin_t *skin = &mdl->skins[index];
+    int width = model->header.skinwidth, height = model->header.skinheight;
+    double start = I_FloatTime();
+    (void)state;
+
+    // Skin pixels are used in place from the file image
+    const byte *skin_data = MDL_SkinPixels(mdl, skin);
+
+    char skin_filename[1024];
+    SkinFileName(model, skin, "", skin_filename, sizeof(skin_filename));
+    if (skin->sub < 0)
+        VerboseLog(w, "  Saving skin %d to %s (%dx%d pixels)\n", skin->group, skin_filename, width, height);
+    else
+        VerboseLog(w, "  Saving group skin %d (sub-skin %d, ends at %.3fs) to %s (%dx%d pixels)\n",
+                   skin->group, skin->sub, skin->interval, skin_filename, width, height);
+    // Use the loaded Quake palette here
+    size_t mark = w->arena.used;
+    size_t skin_size = SkinFileSize(width, height);
+    byte *skin_buffer = (byte *)ArenaAlloc(&w->arena, skin_size);
+    size_t skin_len;
+    if (skin_format == SKIN_LBM) {
+        skin_len = BuildLBMfile(skin_buffer, skin_data, width, height, loaded_palette, output_rle);
+    } else {
+        byte *luma = output_fullbright ? (byte *)ArenaAlloc(&w->arena, skin_size) : NULL;
+        int fullbright;
+        skin_len = BuildTrueColorFile(skin_buffer, luma, skin_data, width, height, &fullbright);
+        if (fullbright) {
+            char luma_filename[1100];
+            SkinFileName(model, skin, "_luma", luma_filename, sizeof(luma_filename));
+            VerboseLog(w, "  Saving %d fullbright pixels to %s\n", fullbright, luma_filename);
+            // Masks sort after all the skins in a container
+            SaveOutput(model, OUTPUT_SKIN, mdl->numskins + index, luma_filename, luma, skin_len);
+        }
+    }
+    SaveOutput(model, OUTPUT_SKIN, index, skin_filename, skin_buffer, skin_len);
+    w->arena.used = mark;
+    AddPhase(&w->stats, PHASE_SKINS, start, skin_len);
+}
+
+const outputbackend_t skin_backend = { "skins", NULL, NULL, WriteSkin, NULL, NULL };
+
+// The frame formats --format can choose from
+const outputbackend_t *output_backends[] = { &tri_backend, &glb_backend, &mda_backend, &index_backend };
+#define NUM_OUTPUT_BACKENDS (int)(sizeof(output_backends) / sizeof(output_backends[0]))
+
+const outputbackend_t *frame_backends[MAX_BACKENDS];   // Chosen by --format, --glb and --mda
+int num_frame_backends;
+
+// EnableFormat: Adds a frame format by name (len bytes of it). Naming one twice
+// is harmless. Returns false for an unknown name.
+qboolean EnableFormat (const char *name, size_t len)
+{
+    for (int i = 0; i < NUM_OUTPUT_BACKENDS; i++) {
+        const outputbackend_t *b = output_backends[i];
+        if (strlen(b->name) != len || strncmp(b->name, name, len))
+            continue;
+        for (int j = 0; j < num_frame_backends; j++) {
+            if (frame_backends[j] == b)
+                return true;
+        }
+        frame_backends[num_frame_backends++] = b;
+        return true;
+    }
+    return false;
+}
+
+// ParseFormats: --format LIST, a comma separated list of frame formats.
+void ParseFormats (const char *list)
+{
+    const char *p = list;
+    for (;;) {
+        size_t len = strcspn(p, ",");
+        if (!EnableFormat(p, len))
+            Error("Unknown format '%.*s' in --format %s (expected tri, glb, mda or index).", (int)len, p, list);
+        if (!p[len])
+            break;
+        p += len + 1;
+    }
+}
+
+// AddBackend: Enables a backend for one model and runs its begin step.
+void AddBackend (worker_t *w, mdlmodel_t *model, const outputbackend_t *backend)
+{
+    int i = model->numbackends++;
+    model->backends[i] = backend;
+    model->backendstate[i] = backend->begin ? backend->begin(w, model) : NULL;
+}
+
+// FinishModel: Waits for the model's queued outputs, closes its container and
+// writes its --incremental manifest.
+void FinishModel (worker_t *w, mdlmodel_t *model, const char *manifest, unsigned long long inputhash)
+{
+    char message[1024];
+    if (model->writes && !WaitForOutputs(&write_queue, model->writes, message, sizeof(message)))
+        Error("%s", message);
+    if (model->pak) {
+        ClosePak(model->pak);
+        Log(w, "Wrote %d entries to %s\n", w->pak.numentries, w->pak.filename);
+        if (model->cache) {
+            struct stat st;
+            if (StatOutput(w->pak.filename, &st) == 0
+                && !AddCacheEntry(model->cache, &model->cache->out, w->pak.filename, 0, (size_t)st.st_size))
+                Error("Failed to allocate the output cache.");
+        }
+    }
+    if (model->cache) {
+        WriteManifest(model->cache, manifest, inputhash, model->mdl->size);
+        Log(w, "%d of %d outputs unchanged and not rewritten\n", model->cache->unchanged, model->cache->out.numentries);
+    }
+}
+
+// ModelName: The file name of an input without its directory and extension, as
+// len bytes at the returned pointer. A model read from stdin is named stdin_name.
+const char *ModelName (const char *input, size_t *len)
+{
+    if (!strcmp(input, "-"))
+        input = stdin_name;
+    const char *name = input;
+    for (const char *p = input; *p; p++) {
+#ifdef _WIN32
+        if (*p == '\\')
+            name = p + 1;
+#endif
+        if (*p == '/')
+            name = p + 1;
+    }
+    const char *dot = strrchr(name, '.');
+    *len = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+    return name;
+}
+
+// ModelOutputBase: The output name prefix of a model. Without --outdir it is the
+// input path without its extension, so outputs land next to the input. With
+// --outdir it is the model's file name inside the output directory, in its own
+// subdirectory for --outdir-layout=model, and under one of 256 shard directories
+// picked by a hash of the name for hashed; those are created here.
+void ModelOutputBase (const char *input, char *out, size_t size)
+{
+    size_t len;
+    const char *name = ModelName(input, &len);
+    int n;
+
+    if (!output_dir) {
+        if (!strcmp(input, "-"))
+            n = snprintf(out, size, "%s", stdin_name);
+        else
+            n = snprintf(out, size, "%.*s", (int)(name - input + len), input);
+    } else if (output_dir_layout == OUTDIR_FLAT) {
+        n = snprintf(out, size, "%.*s", (int)len, name);
+    } else {
+        char shard[4] = "";
+        if (output_dir_layout == OUTDIR_HASHED) {
+            snprintf(shard, sizeof(shard), "%02x/", (unsigned)(HashBytes(name, len, FNV_OFFSET) & 0xff));
+            shard[2] = '\0';
+            MakeOutputDir(shard);
+            shard[2] = '/';
+        }
+        n = snprintf(out, size, "%s%.*s", shard, (int)len, name);
+        if (n >= 0 && (size_t)n < size)
+            MakeOutputDir(out);
+        n = snprintf(out, size, "%s%.*s/%.*s", shard, (int)len, name, (int)len, name);
+    }
+    if (n < 0 || (size_t)n >= size)
+        Error("Output name for %s is too long.", input);
+}
+
+// ConvertMDLFile: Extracts the skins and frames of one model. Errors raised while
+// parsing unwind back to ConvertMDL.
+void ConvertMDLFile (worker_t *w, char *input_mdl_filename)
+{
+    char out_filename_base[1024];
+
+    // Determine output base filename (e.g., "model" from "model.mdl")
+    ModelOutputBase(input_mdl_filename, out_filename_base, sizeof(out_filename_base));
+
+	mdlfile_t *mdl_file = &w->mdl_file;
+	double start = I_FloatTime();
+	LoadMDLFile(input_mdl_filename, mdl_file, &w->memory);
+	AddPhase(&w->stats, PHASE_LOAD, start, mdl_file->size);
+	Log(w, "Reading MDL file: %s (%zu bytes, %s)\n", input_mdl_filename, mdl_file->size,
+           mdl_file->mapped ? "mapped" : "read");
+
+    char manifest[1100] = "";
+    unsigned long long inputhash = 0;
+    if (output_incremental) {
+        snprintf(manifest, sizeof(manifest), "%s.mdlcache", out_filename_base);
+        LoadManifest(&w->cache, manifest);
+        inputhash = HashBytes(mdl_file->data, mdl_file->size, FNV_OFFSET);
+        if (ModelUpToDate(&w->cache, inputhash, mdl_file->size)) {
+            Log(w, "Up to date (%d outputs), skipped\n", w->cache.old.numentries);
+            return;
+        }
+    }
+
+    // Print struct sizes for debugging padding issues
+    VerboseLog(w, "DEBUG: sizeof(trivertx_t): %zu\n", sizeof(trivertx_t));
+    VerboseLog(w, "DEBUG: sizeof(daliasframe_t): %zu\n", sizeof(daliasframe_t));
+    VerboseLog(w, "DEBUG: sizeof(daliasgroup_t): %zu\n", sizeof(daliasgroup_t));
+
+
+	mdl_t *mdl = &w->mdl;
+	start = I_FloatTime();
+	if (MDL_ReadHeader(mdl, mdl_file->data, mdl_file->size) != MDL_OK)
+	    Error("%s: %s", mdl_file->filename, mdl->error);
+	mdl_header_t header = mdl->header;
+    AddPhase(&w->stats, PHASE_HEADER, start, sizeof(header));
+
+    Log(w, "MDL Header Info:\n");
+    Log(w, "  Version: %d\n", header.version);
+    Log(w, "  Skins: %d (%dx%d)\n", header.numskins, header.skinwidth, header.skinheight);
+    Log(w, "  Vertices: %d\n", header.numverts);
+    Log(w, "  Triangles: %d\n", header.numtris);
+    Log(w, "  Frames: %d\n", header.numframes);
+    Log(w, "  Scale: (%.4f, %.4f, %.4f)\n", header.scale[0], header.scale[1], header.scale[2]);
+    Log(w, "  Scale Origin: (%.4f, %.4f, %.4f)\n", header.scale_origin[0], header.scale_origin[1], header.scale_origin[2]);
+
+
+    // Size the worker arena once for the skin buffers and the UV table; frame
+    // threads size their own arenas in ExtractFrames. MDL_ReadHeader has checked
+    // that the file backs every count here (the skin size only when there are
+    // skins), so the reserve is a small multiple of the file size. The skin and
+    // frame tables are left to libmdl, which allocates them from the arena at the
+    // sizes its walks count; they join the arena's high-water mark from there.
+    unsigned long long skinbuffers = header.numskins && extract_skins ? SkinFileSize(header.skinwidth, header.skinheight) : 0;
+    unsigned long long reserve = skinbuffers * (output_fullbright ? 2 : 1)
+                               + (unsigned long long)header.numtris * 3 * 2 * sizeof(float)
+                               + 4 * ARENA_ALIGN;
+    if (reserve > SIZE_MAX / 2)
+        Error("%s: model tables would need %llu bytes.", mdl_file->filename, reserve);
+    ArenaReserve(&w->arena, (size_t)reserve);
+
+    // --- Parse the Model ---
+    // libmdl walks the skins, ST vertices, triangles and frame type words once,
+    // checks every triangle's indices and builds the skin and frame tables.
+    mdlallocator_t allocator = { ArenaModelAlloc, NULL, &w->arena };
+    start = I_FloatTime();
+    if (MDL_LoadModel(mdl, mdl_file->data, mdl_file->size, &allocator) != MDL_OK)
+        Error("%s: %s", mdl_file->filename, mdl->error);
+    if (mdl->numskins != header.numskins)
+        Log(w, "  Skin table: %d skins (skin groups expanded)\n", mdl->numskins);
+    AddPhase(&w->stats, PHASE_MESH, start, (size_t)header.numverts * sizeof(stvert_t) + (size_t)header.numtris * sizeof(dtriangle_t));
+
+    mdlmodel_t model;
+    resample_t resample;
+    memset(&model, 0, sizeof(model));
+    SetModel(&model, mdl);
+    model.outbase = out_filename_base;
+    model.cache = output_incremental ? &w->cache : NULL;
+    model.writes = write_queue.numthreads ? &w->writes : NULL;
+
+    if (output_container) {
+        char pak_filename[1024];
+        if (snprintf(pak_filename, sizeof(pak_filename), "%s.pak", out_filename_base) >= (int)sizeof(pak_filename))
+            Error("Output name %s.pak is too long.", out_filename_base);
+        Log(w, "Writing container %s\n", pak_filename);
+        OpenPak(&w->pak, pak_filename);
+        model.pak = &w->pak;
+    }
+
+    if (extract_frames) {
+        // --- Resolve Texture Coordinates ---
+        // The ST vertices describe how vertices map to the 2D texture. Together with
+        // the triangles' facesfront flags they give the UV of every triangle corner.
+        Log(w, "\nResolving Texture Coordinates...\n");
+        start = I_FloatTime();
+        float *uvs = (float *)ArenaAlloc(&w->arena, (size_t)header.numtris * 3 * 2 * sizeof(float));
+        MDL_BuildUVTable(mdl, uvs);
+        model.uvs = uvs;
+        AddPhase(&w->stats, PHASE_MESH, start, 0);
+
+        // --- Extract Frames ---
+        // The frame table was built with the model, so frames are decoded and written
+        // in parallel, since each one only depends on its own slice of the file.
+
+        Log(w, "\nIndexing Frames...\n");
+        Log(w, "  %d frame entries\n", model.numframes);
+        float *durations = resample_rate > 0 ? FrameDurations(&model, &w->arena) : NULL;
+        if (num_frame_ranges || frame_names) {
+            int total = model.numframes;
+            SelectFrames(&model, durations);
+            Log(w, "  %d of %d frames selected\n", model.numframes, total);
+        }
+        if (durations && model.numframes) {
+            int total = model.numframes;
+            BuildResample(w, &model, durations, &resample);
+            Log(w, "  Resampling %d frames (%.3f s) to %d frames at %g Hz\n", total,
+                resample.times[total - 1], model.numframes, resample_rate);
+        }
+        for (int f = 0; verbose && f < model.numframes; f++) {
+            const mdlframe_t *frame = &model.frames[f];
+            if (frame->sub < 0)
+                Log(w, "  Frame entry %d: single '%s' at offset %zu\n", frame->group, frame->name, frame->offset);
+            else
+                Log(w, "  Frame entry %d: group sub-frame %d '%s' at offset %zu\n", frame->group, frame->sub, frame->name, frame->offset);
+        }
+    }
+
+    // --- Write the Outputs ---
+    // Every backend sees the same parsed model, and every frame is decoded once
+    // for all of the frame formats.
+    if (extract_skins)
+        AddBackend(w, &model, &skin_backend);
+    for (int i = 0; extract_frames && i < num_frame_backends; i++)
+        AddBackend(w, &model, frame_backends[i]);
+
+    if (extract_skins) {
+        Log(w, "\nExtracting Skins...\n");
+        for (int i = 0; i < model.numbackends; i++) {
+            for (int s = 0; model.backends[i]->skin && s < mdl->numskins; s++)
+                model.backends[i]->skin(w, &model, model.backendstate[i], s);
+        }
+    }
+    if (extract_frames) {
+        Log(w, "\nExtracting Frames...\n");
+        for (int i = 0; i < model.numbackends; i++) {
+            if (model.backends[i]->frame) {
+                ExtractFrames(w, &model);
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < model.numbackends; i++) {
+        if (model.backends[i]->end)
+            model.backends[i]->end(w, &model, model.backendstate[i]);
+    }
+
+    FinishModel(w, &model, manifest, inputhash);
+}
+
+// ConvertMDL: Converts one model, returning 0 on success or 1 if it failed. The
+// model's log (including any error) is printed as one block when it is done.
+int ConvertMDL (worker_t *w, char *filename)
+{
+    jmp_buf env;
+    volatile int failed = 0;
+
+    volatile int allocations = WorkerAllocations(w);
+    volatile double start = I_FloatTime();
+
+    memset(&w->stats, 0, sizeof(w->stats));
+    if (setjmp(env) == 0) {
+        error_jmp = &env;
+        ConvertMDLFile(w, filename);
+        Log(w, "Finished %s (%d heap allocations)\n", filename, WorkerAllocations(w) - allocations);
+    } else {
+        Log(w, "************ ERROR ************\n%s\n", error_message);
+        failed = 1;
+    }
+    error_jmp = NULL;
+    // Outputs still queued by a failed conversion are finished before the worker
+    // moves on; they were written by the model's own SaveOutput calls.
+    if (failed && write_queue.numthreads) {
+        char message[1024];
+        WaitForOutputs(&write_queue, &w->writes, message, sizeof(message));
+    }
+    w->stats.seconds = I_FloatTime() - start;
+    w->stats.models = 1;
+    w->stats.failed = failed;
+
+    // Release the file image (st_verts and triangles_indices point into it)
+    if (w->mdl_file.data)
+        FreeMDLFile(&w->mdl_file);
+    if (w->pak.f) {
+        fclose(w->pak.f);   // Left open by a failed conversion
+        w->pak.f = NULL;
+    }
+    // A JSON report or the benchmark owns the output; only errors are logged
+    if (log_quiet && !failed)
+        w->log_len = 0;
+    FlushLog(w, failed || output_stdout ? stderr : stdout);
+    return failed;
+}
+
+
+// --- Probe Mode ---
+// --probe prints one inventory record per model without writing any outputs. It
+// reads the header, checks the size it implies against the file length in O(1),
+// then walks the skin and frame type words to find the model's exact size. With
+// a mapped file only the pages holding those words are read.
+typedef enum { PROBE_NONE, PROBE_TSV, PROBE_JSON } probemode_t;
+
+probemode_t probe_mode;
+
+typedef struct {
+    mdl_header_t    header;
+    int             numentries;     // Frame table entries, counting group sub-frames
+    int             numskins;       // Skin table entries, counting group sub-skins
+    size_t          filesize;
+    size_t          modelsize;      // Bytes the model occupies; filesize when intact
+    unsigned long long decodedsize; // Estimated output size (.lbm and .tri files)
+} probe_t;
+
+// ProbeMDLFile: Gathers the probe record for one model.
+void ProbeMDLFile (worker_t *w, char *filename, probe_t *probe)
+{
+    mdlfile_t *mdl_file = &w->mdl_file;
+    mdl_t *mdl = &w->mdl;
+
+    LoadMDLFile(filename, mdl_file, &w->memory);
+#ifndef _WIN32
+    if (mdl_file->mapped)
+        madvise(mdl_file->data, mdl_file->size, MADV_RANDOM); // Only a few words are read
+#endif
+    probe->filesize = mdl_file->size;
+    mdlerror_t error = MDL_ScanModel(mdl, mdl_file->data, mdl_file->size);
+    probe->header = mdl->header;    // Filled in even for a rejected model
+    if (error != MDL_OK)
+        Error("%s: %s", mdl_file->filename, mdl->error);
+    probe->numentries = mdl->numframes;
+    probe->numskins = mdl->numskins;
+    probe->modelsize = mdl->modelsize;
+
+    const mdl_header_t *header = &probe->header;
+    probe->decodedsize = (unsigned long long)probe->numskins * LBMFileSize(header->skinwidth, header->skinheight)
+                       + (unsigned long long)probe->numentries * TriFileSize(header->numtris);
+}
+
+// ProbeMDL: Probes one model and logs its record. Returns 1 if the file is
+// corrupt, truncated or has trailing bytes.
+int ProbeMDL (worker_t *w, char *filename)
+{
+    jmp_buf env;
+    probe_t probe;
+    const char * volatile status = "ok";
+
+    memset(&probe, 0, sizeof(probe));
+    if (setjmp(env) == 0) {
+        error_jmp = &env;
+        ProbeMDLFile(w, filename, &probe);
+        if (probe.modelsize != probe.filesize) {
+            snprintf(error_message, sizeof(error_message), "model ends at %zu, file has %zu bytes", probe.modelsize, probe.filesize);
+            status = "mismatch";
+        }
+    } else {
+        status = "error";
+    }
+    error_jmp = NULL;
+    if (w->mdl_file.data)
+        FreeMDLFile(&w->mdl_file);
+
+    const mdl_header_t *h = &probe.header;
+    const char *message = strcmp(status, "ok") ? error_message : "";
+    if (probe_mode == PROBE_JSON) {
+        Log(w, "{\"file\": ");
+        LogJSONString(w, filename);
+        Log(w, ", \"status\": \"%s\", \"version\": %d, \"skins\": %d, \"skinwidth\": %d, \"skinheight\": %d, "
+               "\"verts\": %d, \"tris\": %d, \"frames\": %d, \"entries\": %d, \"flags\": %d, \"synctype\": %d, "
+               "\"filesize\": %zu, \"decodedsize\": %llu, \"message\": ",
+            status, h->version, h->numskins, h->skinwidth, h->skinheight, h->numverts, h->numtris,
+            h->numframes, probe.numentries, h->flags, (int)h->synctype, probe.filesize, probe.decodedsize);
+        LogJSONString(w, message);
+        Log(w, "}\n");
+    } else {
+        Log(w, "%s\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%zu\t%llu\t%s\n",
+            filename, status, h->version, h->numskins, h->skinwidth, h->skinheight, h->numverts, h->numtris,
+            h->numframes, probe.numentries, h->flags, (int)h->synctype, probe.filesize, probe.decodedsize, message);
+    }
+    FlushLog(w, stdout);
+    return strcmp(status, "ok") != 0;
+}
+
+
+// --- Batch Input List ---
+// Inputs may be .mdl files, directories (searched recursively for .mdl files) or
+// @response files listing one input per line.
+typedef struct {
+    char    **names;
+    int     count;
+    int     size;
+} filelist_t;
+
+void AddInputFile (filelist_t *list, const char *name)
+{
+    if (list->count == list->size) {
+        list->size = list->size ? list->size * 2 : 64;
+        list->names = (char **)realloc(list->names, list->size * sizeof(char *));
+        if (!list->names)
+            Error("Failed to allocate memory for the input list.");
+    }
+    list->names[list->count] = strdup(name);
+    if (!list->names[list->count])
+        Error("Failed to allocate memory for the input list.");
+    list->count++;
+}
+
+// HasMDLExtension: Case-insensitive check for a ".mdl" suffix.
+int HasMDLExtension (const char *name)
+{
+    size_t len = strlen(name);
+    if (len < 4)
+        return 0;
+    const char *ext = name + len - 4;
+    return ext[0] == '.' && (ext[1] | 0x20) == 'm' && (ext[2] | 0x20) == 'd' && (ext[3] | 0x20) == 'l';
+}
+
+void AddInputDirectory (filelist_t *list, const char *dirname)
+{
+    DIR *dir = opendir(dirname);
+    if (!dir)
+        Error("Error opening directory %s: %s", dirname, strerror(errno));
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+            continue;
+        char path[1024];
+        if (snprintf(path, sizeof(path), "%s/%s", dirname, ent->d_name) >= (int)sizeof(path)) {
+            fprintf(stderr, "Skipping %s/%s: path too long\n", dirname, ent->d_name);
+            continue;
+        }
+        struct stat st;
+        if (stat(path, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            AddInputDirectory(list, path);
+        else if (HasMDLExtension(ent->d_name))
+            AddInputFile(list, path);
+    }
+    closedir(dir);
+}
+
+void AddInputResponseFile (filelist_t *list, const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f)
+        Error("Error opening response file %s: %s", filename, strerror(errno));
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0 || line[0] == '#')
+            continue;
+        AddInputFile(list, line);
+    }
+    fclose(f);
+}
+
+// AddInput: Adds a command-line input, expanding directories and response files.
+void AddInput (filelist_t *list, const char *name)
+{
+    struct stat st;
+    if (name[0] == '@')
+        AddInputResponseFile(list, name + 1);
+    else if (stat(name, &st) == 0 && S_ISDIR(st.st_mode))
+        AddInputDirectory(list, name);
+    else
+        AddInputFile(list, name);
+}
+
+int CompareNames (const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+int CompareModelNames (const void *a, const void *b)
+{
+    const char *x = *(const char * const *)a, *y = *(const char * const *)b;
+    size_t xlen, ylen;
+    x = ModelName(x, &xlen);
+    y = ModelName(y, &ylen);
+    int c = memcmp(x, y, xlen < ylen ? xlen : ylen);
+    return c ? c : (xlen > ylen) - (xlen < ylen);
+}
+
+// CheckOutputNames: With --outdir, models are named after their file name alone,
+// so two inputs with the same name would write over each other's outputs.
+// Reports every clash and returns false if there is one.
+qboolean CheckOutputNames (const filelist_t *list)
+{
+    const char **names = (const char **)malloc((list->count + 1) * sizeof(char *));
+    qboolean ok = true;
+    if (!names)
+        Error("Failed to allocate memory for the input list.");
+    memcpy(names, list->names, list->count * sizeof(char *));
+    qsort(names, list->count, sizeof(char *), CompareModelNames);
+    for (int i = 1; i < list->count; i++) {
+        if (!CompareModelNames(&names[i - 1], &names[i])) {
+            fprintf(stderr, "%s and %s would write the same outputs in --outdir %s.\n", names[i - 1], names[i], output_dir);
+            ok = false;
+        }
+    }
+    free(names);
+    return ok;
+}
+
+
+// --- Main Program Logic ---
+typedef struct {
+    filelist_t  *list;
+    worker_t    *workers;
+    stats_t     *stats;     // One record per input, for --stats
+    int         threads;    // Workers
+    int         failed;
+    pthread_mutex_t lock;
+} batch_t;
+
+void ConvertBatchModel (int threadnum, int work, void *arg)
+{
+    batch_t *batch = (batch_t *)arg;
+    worker_t *w = &batch->workers[threadnum];
+    int failed = probe_mode != PROBE_NONE ? ProbeMDL(w, batch->list->names[work])
+                                          : ConvertMDL(w, batch->list->names[work]);
+    if (failed) {
+        pthread_mutex_lock(&batch->lock);
+        batch->failed++;
+        pthread_mutex_unlock(&batch->lock);
+    }
+    if (batch->stats)
+        batch->stats[work] = w->stats;
+}
+
+// InitBatch: Sets up the workers of a batch that converts up to threads models at once.
+void InitBatch (batch_t *batch, int threads)
+{
+    batch->threads = threads;
+    pthread_mutex_init(&batch->lock, NULL);
+    batch->workers = (worker_t *)malloc(threads * sizeof(worker_t));
+    if (!batch->workers)
+        Error("Failed to allocate worker state.");
+    for (int i = 0; i < threads; i++)
+        InitWorker(&batch->workers[i]);
+}
+
+// RunBatch: Converts every model in list with the batch's workers, filling in one
+// stats record per model. Returns the number of models that failed. The workers
+// keep their arenas, so a batch can be run again without heap allocations.
+int RunBatch (batch_t *batch, filelist_t *list, stats_t *stats)
+{
+    // Threads left over when there are fewer models than threads go to the
+    // frames of each model, so a single large model can use the whole machine.
+    int threads = batch->threads;
+    framethreads = threads / (list->count ? list->count : 1);
+    if (framethreads < 1)
+        framethreads = 1;
+    if (threads > list->count)
+        threads = list->count;
+
+    batch->list = list;
+    batch->stats = stats;
+    batch->failed = 0;
+    if (list->count)
+        RunThreadsOn(list->count, threads, ConvertBatchModel, batch);
+    return batch->failed;
+}
+
+void FreeBatch (batch_t *batch)
+{
+    for (int i = 0; i < batch->threads; i++)
+        FreeWorker(&batch->workers[i]);
+    free(batch->workers);
+    pthread_mutex_destroy(&batch->lock);
+}
+
+// StartBatchWriters: Starts the writer threads, unless outputs must be written in order.
+void StartBatchWriters (void)
+{
+    // Probes write nothing, and the tar stream must be written in order
+    if (output_writers > 0 && probe_mode == PROBE_NONE && !output_stdout)
+        StartWriters(&write_queue, output_writers, output_queue_depth ? output_queue_depth : 4 * output_writers);
+}
+
+// ConvertBatch: Converts every model in list on up to threads threads, filling
+// in one stats record per model. Returns the number of models that failed.
+int ConvertBatch (filelist_t *list, int threads, stats_t *stats)
+{
+    batch_t batch;
+    InitBatch(&batch, threads);
+    StartBatchWriters();
+    int failed = RunBatch(&batch, list, stats);
+    StopWriters(&write_queue);
+    FreeBatch(&batch);
+    return failed;
+}
+
+
+// --- Synthetic Models and Benchmark ---
+// --bench generates valid models from the structures above, converts them as a
+// batch on one thread and on all threads, then times each phase on its own over
+// the first model's image. The numbers are meant to be compared between builds
+// on the same machine, to catch regressions and to weigh serial against parallel.
+typedef struct {
+    int     numverts;
+    int     numtris;
+    int     numsingles;     // Single frames
+    int     groupframes;    // Sub-frames in a frame group between the singles (0 for none)
+    int     numskins;       // Single skins
+    int     groupskins;     // Sub-skins in a trailing skin group (0 for none)
+    int     skinwidth;
+    int     skinheight;
+    int     models;         // Models in the batch
+    int     iterations;     // Batch runs, and minimum passes per phase
+    unsigned seed;
+    char    dir[1024];      // Where models and outputs are written
+} benchspec_t;
+
+// BenchRandom: xorshift32, so generated models are the same on every platform.
+unsigned BenchRandom (unsigned *state)
+{
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// ParseBenchSpec: Parses a comma-separated key=value list over the defaults,
+// e.g. "verts=1000,tris=2000,frames=200,group=8,skins=2,skin=320x200".
+void ParseBenchSpec (const char *text, benchspec_t *spec)
+{
+    spec->numverts = 500;
+    spec->numtris = 1000;
+    spec->numsingles = 64;
+    spec->groupframes = 8;
+    spec->numskins = 1;
+    spec->groupskins = 0;
+    spec->skinwidth = 320;
+    spec->skinheight = 200;
+    spec->models = 8;
+    spec->iterations = 3;
+    spec->seed = 1;
+    strcpy(spec->dir, "bench");
+
+    while (text && *text) {
+        char key[32];
+        const char *value = strchr(text, '=');
+        const char *end = strchr(text, ',');
+        if (!end)
+            end = text + strlen(text);
+        if (!value || value > end || value - text >= (int)sizeof(key))
+            Error("Bad benchmark setting \"%.*s\"; expected key=value.", (int)(end - text), text);
+        memcpy(key, text, value - text);
+        key[value - text] = '\0';
+        value++;
+
+        if (!strcmp(key, "dir")) {
+            if (end - value >= (int)sizeof(spec->dir))
+                Error("Benchmark directory name is too long.");
+            memcpy(spec->dir, value, end - value);
+            spec->dir[end - value] = '\0';
+        } else if (!strcmp(key, "skin")) {
+            if (sscanf(value, "%dx%d", &spec->skinwidth, &spec->skinheight) != 2)
+                Error("Bad benchmark skin size \"%.*s\"; expected WxH.", (int)(end - value), value);
+        } else {
+            int n = atoi(value);
+            if (!strcmp(key, "verts"))              spec->numverts = n;
+            else if (!strcmp(key, "tris"))          spec->numtris = n;
+            else if (!strcmp(key, "frames"))        spec->numsingles = n;
+            else if (!strcmp(key, "group"))         spec->groupframes = n;
+            else if (!strcmp(key, "skins"))         spec->numskins = n;
+            else if (!strcmp(key, "skingroup"))     spec->groupskins = n;
+            else if (!strcmp(key, "models"))        spec->models = n;
+            else if (!strcmp(key, "iterations"))    spec->iterations = n;
+            else if (!strcmp(key, "seed"))          spec->seed = (unsigned)n;
+            else
+                Error("Unknown benchmark setting \"%s\".", key);
+        }
+        text = *end ? end + 1 : end;
+    }
+
+    if (spec->numverts < 1 || spec->numverts > 65536 || spec->numtris < 1 || spec->numtris > 1 << 20
+        || spec->numsingles < 0 || spec->groupframes < 0 || spec->numsingles + spec->groupframes < 1
+        || spec->numsingles + spec->groupframes > 10000 || spec->numskins < 0 || spec->numskins > 64
+        || spec->groupskins < 0 || spec->groupskins > 64
+        || spec->skinwidth < 1 || spec->skinwidth > 4096 || spec->skinheight < 1 || spec->skinheight > 4096
+        || spec->models < 1 || spec->models > 10000 || spec->iterations < 1)
+        Error("Benchmark settings out of range.");
+    if (!spec->seed)
+        spec->seed = 1;
+}
+
+// MDLSize: Size of the file image GenerateMDL builds.
+size_t MDLSize (const benchspec_t *spec)
+{
+    size_t framesize = sizeof(daliasframe_t) + (size_t)spec->numverts * sizeof(trivertx_t);
+    size_t size = sizeof(mdl_header_t)
+                + (size_t)spec->numskins * (4 + (size_t)spec->skinwidth * spec->skinheight)
+                + (size_t)spec->numverts * sizeof(stvert_t)
+                + (size_t)spec->numtris * sizeof(dtriangle_t)
+                + (size_t)spec->numsingles * (4 + framesize);
+    if (spec->groupskins)
+        size += 4 + 4 + (size_t)spec->groupskins * (sizeof(float) + (size_t)spec->skinwidth * spec->skinheight);
+    if (spec->groupframes)
+        size += 4 + sizeof(daliasgroup_t) + (size_t)spec->groupframes * (sizeof(float) + framesize);
+    return size;
+}
+
+// PutFrame: Writes one daliasframe_t and its vertices. Each vertex moves a little
+// from frame to frame around its base position, like a real animation.
+byte *PutFrame (byte *out, const benchspec_t *spec, const byte *base, int frame, char *name, unsigned *state)
+{
+    daliasframe_t header;
+    memset(&header, 0, sizeof(header));
+    memset(header.bboxmax.v, 255, sizeof(header.bboxmax.v));
+    snprintf(header.name, sizeof(header.name), "%s", name);
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+
+    for (int v = 0; v < spec->numverts; v++, out += sizeof(trivertx_t)) {
+        for (int k = 0; k < 3; k++) {
+            int c = base[v * 3 + k] + (int)((frame * (v + k + 1)) % 9) - 4;
+            out[k] = (byte)(c < 0 ? 0 : c > 255 ? 255 : c);
+        }
+        out[3] = (byte)(BenchRandom(state) % 162);
+    }
+    return out;
+}
+
+// PutSkin: Writes one skin's pixels, runs of random lengths to give ByteRun1
+// something to do.
+byte *PutSkin (byte *out, const benchspec_t *spec, unsigned *state)
+{
+    size_t count = (size_t)spec->skinwidth * spec->skinheight;
+    for (size_t p = 0; p < count; ) {
+        size_t run = 1 + BenchRandom(state) % 16;
+        byte color = (byte)BenchRandom(state);
+        if (run > count - p)
+            run = count - p;
+        memset(out + p, color, run);
+        p += run;
+    }
+    return out + count;
+}
+
+// GenerateMDL: Builds a valid model image (MDLSize bytes) with spec's counts: the
+// single skins come first, then the skin group; the frame group sits between
+// the two halves of the single frames.
+byte *GenerateMDL (const benchspec_t *spec, unsigned seed)
+{
+    size_t size = MDLSize(spec);
+    byte *image = (byte *)malloc(size);
+    byte *base = (byte *)malloc((size_t)spec->numverts * 3);
+    if (!image || !base)
+        Error("Failed to allocate a %zu byte benchmark model.", size);
+    byte *out = image;
+    unsigned state = seed;
+    int i;
+
+    mdl_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.ident = IDPOLYHEADER;
+    header.version = ALIAS_VERSION;
+    header.scale[0] = header.scale[1] = header.scale[2] = 0.25f;
+    header.scale_origin[0] = header.scale_origin[1] = header.scale_origin[2] = -32.0f;
+    header.boundingradius = 56.0f;
+    header.eyeposition[2] = 22.0f;
+    header.numskins = spec->numskins + (spec->groupskins ? 1 : 0);
+    header.skinwidth = spec->skinwidth;
+    header.skinheight = spec->skinheight;
+    header.numverts = spec->numverts;
+    header.numtris = spec->numtris;
+    header.numframes = spec->numsingles + (spec->groupframes ? 1 : 0);
+    header.synctype = ST_SYNC;
+    header.size = 10.0f;
+    // Every number is stored little-endian, like any .mdl
+    MDL_LittleLongs(out, &header, sizeof(header) / 4);
+    out += sizeof(header);
+
+    for (i = 0; i < spec->numskins; i++) {
+        WriteLittleLongToBuffer(out, ALIAS_SKIN_SINGLE);
+        out += 4;
+        out = PutSkin(out, spec, &state);
+    }
+    if (spec->groupskins) {
+        WriteLittleLongToBuffer(out, ALIAS_SKIN_GROUP);
+        WriteLittleLongToBuffer(out + 4, spec->groupskins);
+        out += 8;
+        for (i = 0; i < spec->groupskins; i++, out += sizeof(float)) {
+            float interval = 0.1f * (i + 1);
+            MDL_LittleLongs(out, &interval, 1);
+        }
+        for (i = 0; i < spec->groupskins; i++)
+            out = PutSkin(out, spec, &state);
+    }
+
+    for (i = 0; i < spec->numverts; i++, out += sizeof(stvert_t)) {
+        stvert_t st;
+        st.onseam = BenchRandom(&state) % 8 ? 0 : 32;
+        st.s = BenchRandom(&state) % (spec->skinwidth / 2 + 1);
+        st.t = BenchRandom(&state) % spec->skinheight;
+        MDL_LittleLongs(out, &st, sizeof(st) / 4);
+    }
+    for (i = 0; i < spec->numtris; i++, out += sizeof(dtriangle_t)) {
+        dtriangle_t tri;
+        tri.facesfront = BenchRandom(&state) % 2;
+        for (int k = 0; k < 3; k++)
+            tri.vertindex[k] = BenchRandom(&state) % spec->numverts;
+        MDL_LittleLongs(out, &tri, sizeof(tri) / 4);
+    }
+
+    for (i = 0; i < spec->numverts * 3; i++)
+        base[i] = (byte)BenchRandom(&state);
+
+    // Half of the single frames go after the group, so the entries following a
+    // group are exercised too
+    char name[24];  // Cut to 16 in the frame header
+    int frame = 0, before = spec->numsingles - spec->numsingles / 2;
+    for (i = 0; i < before; i++) {
+        WriteLittleLongToBuffer(out, ALIAS_SINGLE);
+        out += 4;
+        snprintf(name, sizeof(name), "frame%d", i);
+        out = PutFrame(out, spec, base, frame++, name, &state);
+    }
+    if (spec->groupframes) {
+        WriteLittleLongToBuffer(out, ALIAS_GROUP);
+        out += 4;
+        daliasgroup_t group;
+        memset(&group, 0, sizeof(group));
+        memset(group.bboxmax.v, 255, sizeof(group.bboxmax.v));
+        memcpy(out, &group, sizeof(group));
+        WriteLittleLongToBuffer(out, spec->groupframes);    // daliasgroup_t.numframes
+        out += sizeof(group);
+        for (i = 0; i < spec->groupframes; i++, out += sizeof(float)) {
+            float interval = 0.1f * (i + 1);
+            MDL_LittleLongs(out, &interval, 1);
+        }
+        for (i = 0; i < spec->groupframes; i++) {
+            snprintf(name, sizeof(name), "group%d", i);
+            out = PutFrame(out, spec, base, frame++, name, &state);
+        }
+    }
+    for (i = before; i < spec->numsingles; i++) {
+        WriteLittleLongToBuffer(out, ALIAS_SINGLE);
+        out += 4;
+        snprintf(name, sizeof(name), "frame%d", i);
+        out = PutFrame(out, spec, base, frame++, name, &state);
+    }
+
+    free(base);
+    if ((size_t)(out - image) != size)
+        Error("GenerateMDL: wrote %zu bytes, expected %zu.", (size_t)(out - image), size);
+    return image;
+}
+
+// --- Benchmark Phases ---
+// Each phase runs a pass over the first model's image until it has made at least
+// spec->iterations passes and spent at least BENCH_MIN_TIME seconds.
+#define BENCH_MIN_TIME  0.25
+
+typedef struct {
+    worker_t    w;
+    mdlmodel_t  model;
+    mdl_t       scratch;        // Model the header pass parses into
+    tf_triangle *triangles;     // Triangle soup of frame 0
+    float       *uvs;           // The model's corner UV table
+    byte        *buffer;        // Output buffer for .lbm and .tri files
+    char        filename[1100]; // Scratch file for the write phase
+} benchstate_t;
+
+// Each pass returns the bytes it processed and its item count (models, skins, frames)
+size_t BenchHeader (benchstate_t *b, int *items)
+{
+    mdl_t *mdl = &b->scratch;
+    if (MDL_ReadHeader(mdl, b->w.mdl.data, b->w.mdl.size) != MDL_OK)
+        Error("%s", mdl->error);
+    *items = 1;
+    return sizeof(mdl->header);
+}
+
+size_t BenchSkins (benchstate_t *b, int *items)
+{
+    const mdl_header_t *h = &b->model.header;
+    size_t bytes = 0;
+    for (int i = 0; i < b->w.mdl.numskins; i++) {
+        const byte *skin = MDL_SkinPixels(&b->w.mdl, &b->w.mdl.skins[i]);
+        if (skin_format == SKIN_LBM) {
+            bytes += BuildLBMfile(b->buffer, skin, h->skinwidth, h->skinheight, loaded_palette, output_rle);
+        } else {
+            int fullbright;
+            bytes += BuildTrueColorFile(b->buffer, NULL, skin, h->skinwidth, h->skinheight, &fullbright);
+        }
+    }
+    *items = b->w.mdl.numskins;
+    return bytes;
+}
+
+size_t BenchMesh (benchstate_t *b, int *items)
+{
+    const mdl_header_t *h = &b->model.header;
+    if (MDL_CheckTriangles(&b->w.mdl) != MDL_OK)
+        Error("%s", b->w.mdl.error);
+    MDL_BuildUVTable(&b->w.mdl, b->uvs);
+    *items = 1;
+    return (size_t)h->numverts * sizeof(stvert_t) + (size_t)h->numtris * sizeof(dtriangle_t);
+}
+
+size_t BenchDecode (benchstate_t *b, int *items)
+{
+    const mdl_header_t *h = &b->model.header;
+    arena_t *arena = &b->w.framearenas[0];
+    decodedframe_t decoded;
+    for (int f = 0; f < b->model.numframes; f++) {
+        ArenaReset(arena);
+        DecodeFrame(&b->model, &b->model.frames[f], arena, &decoded);
+        GatherTriangles(&b->model, &decoded, (tf_triangle *)ArenaAlloc(arena, h->numtris * sizeof(tf_triangle)));
+    }
+    *items = b->model.numframes;
+    return (size_t)b->model.numframes * (sizeof(daliasframe_t) + (size_t)h->numverts * sizeof(trivertx_t));
+}
+
+size_t BenchBuild (benchstate_t *b, int *items)
+{
+    size_t bytes = 0;
+    for (int f = 0; f < b->model.numframes; f++)
+        bytes += BuildTriFile(b->buffer, b->triangles, b->model.header.numtris);
+    *items = b->model.numframes;
+    return bytes;
+}
+
+size_t BenchWrite (benchstate_t *b, int *items)
+{
+    size_t len = TriFileSize(b->model.header.numtris);
+    for (int f = 0; f < b->model.numframes; f++)
+        SaveFile(b->filename, b->buffer, (int)len);
+    *items = b->model.numframes;
+    return (size_t)b->model.numframes * len;
+}
+
+typedef struct {
+    char    *name;
+    size_t  (*pass)(benchstate_t *b, int *items);
+    char    *items;
+} benchphase_t;
+
+static const benchphase_t bench_phases[] = {
+    { "header", BenchHeader, "models" },
+    { "skins",  BenchSkins,  "skins" },
+    { "mesh",   BenchMesh,   "models" },
+    { "decode", BenchDecode, "frames" },
+    { "build",  BenchBuild,  "frames" },
+    { "write",  BenchWrite,  "frames" },
+};
+
+// BenchPhases: Times each phase on its own over the image of one model.
+void BenchPhases (const benchspec_t *spec, byte *image)
+{
+    benchstate_t b;
+
+    memset(&b, 0, sizeof(b));
+    InitWorker(&b.w);
+    if (MDL_LoadModel(&b.w.mdl, image, MDLSize(spec), NULL) != MDL_OK)
+        Error("%s", b.w.mdl.error);
+    SetModel(&b.model, &b.w.mdl);
+
+    const mdl_header_t *h = &b.model.header;
+
+    size_t buffersize = SkinFileSize(h->skinwidth, h->skinheight);
+    if (buffersize < TriFileSize(h->numtris))
+        buffersize = TriFileSize(h->numtris);
+    b.buffer = (byte *)malloc(buffersize);
+    b.triangles = (tf_triangle *)malloc(h->numtris * sizeof(tf_triangle));
+    b.uvs = (float *)malloc((size_t)h->numtris * 3 * 2 * sizeof(float));
+    b.w.framearenas = (arena_t *)calloc(1, sizeof(arena_t));
+    if (!b.buffer || !b.triangles || !b.uvs || !b.w.framearenas)
+        Error("Failed to allocate benchmark buffers.");
+    MDL_BuildUVTable(&b.w.mdl, b.uvs);
+    b.model.uvs = b.uvs;
+    b.w.numframearenas = 1;
+    ArenaReserve(&b.w.framearenas[0], FrameArenaSize(&b.model) + TriFrameArenaSize(&b.model));
+    snprintf(b.filename, sizeof(b.filename), "%s/phase_write.tri", spec->dir);
+
+    decodedframe_t decoded;
+    DecodeFrame(&b.model, &b.model.frames[0], &b.w.framearenas[0], &decoded);
+    GatherTriangles(&b.model, &decoded, b.triangles);
+    BuildTriFile(b.buffer, b.triangles, h->numtris);
+
+    printf("\nPhases, one thread, over one model:\n");
+    printf("  %-8s %8s %10s %19s %10s\n", "phase", "passes", "ms/pass", "items/s", "MB/s");
+    for (size_t p = 0; p < sizeof(bench_phases) / sizeof(bench_phases[0]); p++) {
+        const benchphase_t *phase = &bench_phases[p];
+        size_t bytes = 0;
+        long items = 0;
+        int passes = 0;
+        double start = I_FloatTime(), elapsed;
+        do {
+            int n;
+            bytes += phase->pass(&b, &n);
+            items += n;
+            passes++;
+            elapsed = I_FloatTime() - start;
+        } while (passes < spec->iterations || elapsed < BENCH_MIN_TIME);
+        printf("  %-8s %8d %10.3f %12.0f %-6s %10.1f\n", phase->name, passes, elapsed * 1000 / passes,
+               items / elapsed, phase->items, bytes / elapsed / 1e6);
+    }
+
+    remove(b.filename);
+    free(b.buffer);
+    free(b.triangles);
+    free(b.uvs);
+    MDL_FreeModel(&b.w.mdl);
+    FreeWorker(&b.w);
+}
+
+// Benchmark: Runs the --bench suite and returns the exit status.
+int Benchmark (const char *spectext, int threads)
+{
+    benchspec_t spec;
+    filelist_t list;
+    char name[1100];
+    int i;
+
+    ParseBenchSpec(spectext, &spec);
+    memset(&list, 0, sizeof(list));
+    Q_mkdir(spec.dir);
+
+    printf("Benchmark: %d models, %d verts, %d tris, %d single frames + group of %d, %d skins + group of %d %dx%d%s\n",
+           spec.models, spec.numverts, spec.numtris, spec.numsingles, spec.groupframes,
+           spec.numskins, spec.groupskins, spec.skinwidth, spec.skinheight, output_rle ? " (rle)" : "");
+
+    byte *first = NULL;
+    size_t size = MDLSize(&spec);
+    for (i = 0; i < spec.models; i++) {
+        byte *image = GenerateMDL(&spec, spec.seed + i);
+        snprintf(name, sizeof(name), "%s/bench%d.mdl", spec.dir, i);
+        SaveFile(name, image, (int)size);
+        AddInputFile(&list, name);
+        if (i == 0)
+            first = image;
+        else
+            free(image);
+    }
+
+    stats_t *stats = (stats_t *)calloc(list.count, sizeof(stats_t));
+    if (!stats)
+        Error("Failed to allocate benchmark statistics.");
+
+    // Full extraction of the batch, serial and parallel; the best run counts
+    int modes[2] = { 1, threads };
+    int failed = 0;
+    log_quiet = true;
+    printf("\nFull extraction, best of %d:\n", spec.iterations);
+    printf("  %-8s %10s %10s %12s %10s %10s\n", "threads", "seconds", "models/s", "frames/s", "MB/s in", "MB/s out");
+    for (int m = 0; m < 2; m++) {
+        double best = 0;
+        stats_t total;
+        for (int it = 0; it < spec.iterations; it++) {
+            double start = I_FloatTime();
+            failed += ConvertBatch(&list, modes[m], stats);
+            double seconds = I_FloatTime() - start;
+            if (it == 0 || seconds < best)
+                best = seconds;
+        }
+        memset(&total, 0, sizeof(total));
+        for (i = 0; i < list.count; i++)
+            AddStats(&total, &stats[i]);
+        size_t out = total.phase[PHASE_SKINS].bytes + total.phase[PHASE_WRITE].bytes;
+        printf("  %-8d %10.4f %10.1f %12.0f %10.1f %10.1f\n", modes[m], best, list.count / best,
+               total.phase[PHASE_DECODE].count / best, total.phase[PHASE_LOAD].bytes / best / 1e6, out / best / 1e6);
+    }
+
+    BenchPhases(&spec, first);
+
+    free(first);
+    free(stats);
+    for (i = 0; i < list.count; i++)
+        free(list.names[i]);
+    free(list.names);
+    if (failed)
+        printf("\n%d model conversions failed during the benchmark.\n", failed);
+    return failed ? 1 : 0;
+}
+
+// ReportStats: Prints the --stats report for every model and the batch total.
+void ReportStats (FILE *out, const filelist_t *list, const stats_t *stats, double seconds)
+{
+    stats_t total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < list->count; i++)
+        AddStats(&total, &stats[i]);
+    total.seconds = seconds;
+
+    if (stats_mode == STATS_JSON) {
+        fprintf(out, "{\"models\": [");
+        for (int i = 0; i < list->count; i++) {
+            fprintf(out, "%s\n  {\"name\": ", i ? "," : "");
+            PrintJSONString(out, list->names[i]);
+            fprintf(out, ", ");
+            PrintStatsJSON(out, &stats[i]);
+            fprintf(out, "}");
+        }
+        fprintf(out, "\n], \"total\": {");
+        PrintStatsJSON(out, &total);
+        fprintf(out, "}}\n");
+        return;
+    }
+    for (int i = 0; i < list->count; i++)
+        PrintStats(out, list->names[i], &stats[i]);
+    if (list->count > 1)
+        PrintStats(out, "Total", &total);
+}
+
+// --- Watch Mode ---
+// --watch converts the inputs, then keeps running and reconverts every .mdl that
+// changes under them. The workers, with their arenas, and the writer threads stay
+// up between rounds, so a save costs one parse and the output writes. Changes are
+// debounced: a round starts once --debounce ms have passed without a new event,
+// which lets an editor finish a save made of several writes or a rename.
+// On Linux the inputs are watched with inotify, one watch per directory. Elsewhere,
+// or with --watch=poll (network filesystems), the inputs are rescanned every
+// --debounce ms and a model whose size or modification time moved is converted.
+typedef enum { WATCH_NONE, WATCH_NOTIFY, WATCH_POLL } watchmode_t;
+
+watchmode_t             watch_mode;         // --watch[=poll]
+int                     watch_debounce = 50; // --debounce MS
+volatile sig_atomic_t   watch_stop;         // Set by SIGINT and SIGTERM
+
+typedef struct {
+    int         wd;
+    char        *path;
+    qboolean    whole;      // Every .mdl below counts, not just the inputs in files
+    filelist_t  files;      // Inputs named directly that live in this directory
+} watchdir_t;
+
+typedef struct {
+    char                *name;
+    long long           stamp;      // Modification time, in nanoseconds where available
+    long long           size;
+} watchfile_t;
+
+typedef struct {
+    filelist_t  roots;      // Inputs as given, with response files expanded
+    filelist_t  changed;    // Models to convert in the next round
+    double      lastevent;  // When changed last grew
+    int         fd;         // inotify descriptor, -1 when polling
+    watchdir_t  *dirs;
+    int         numdirs;
+    watchfile_t *files;     // Polling: the last scan, sorted by name
+    int         numfiles;
+} watch_t;
+
+void WatchSignal (int sig)
+{
+    (void)sig;
+    watch_stop = 1;
+}
+
+// AddChanged: Queues a model for the next round, once.
+void AddChanged (watch_t *watch, const char *name)
+{
+    watch->lastevent = I_FloatTime();
+    for (int i = 0; i < watch->changed.count; i++) {
+        if (!strcmp(watch->changed.names[i], name))
+            return;
+    }
+    AddInputFile(&watch->changed, name);
+}
+
+void ClearFileList (filelist_t *list)
+{
+    for (int i = 0; i < list->count; i++)
+        free(list->names[i]);
+    list->count = 0;
+}
+
+#ifdef __linux__
+watchdir_t *FindWatch (watch_t *watch, int wd)
+{
+    for (int i = 0; i < watch->numdirs; i++) {
+        if (watch->dirs[i].wd == wd)
+            return &watch->dirs[i];
+    }
+    return NULL;
+}
+
+// WatchDirectory: Watches dirname and, if whole, every directory below it. With
+// addfiles, the models found on the way are queued: they may have been written
+// before the watch was in place.
+watchdir_t *WatchDirectory (watch_t *watch, const char *dirname, qboolean whole, qboolean addfiles)
+{
+    int wd = inotify_add_watch(watch->fd, dirname, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) {
+        fprintf(stderr, "Cannot watch %s: %s\n", dirname, strerror(errno));
+        return NULL;
+    }
+    watchdir_t *d = FindWatch(watch, wd);
+    if (!d) {
+        if (!(watch->numdirs & (watch->numdirs - 1))) {
+            // Grow at powers of two
+            watchdir_t *dirs = (watchdir_t *)realloc(watch->dirs, (watch->numdirs ? watch->numdirs * 2 : 16) * sizeof(watchdir_t));
+            if (!dirs)
+                Error("Failed to allocate memory for the watch list.");
+            watch->dirs = dirs;
+        }
+        d = &watch->dirs[watch->numdirs++];
+        memset(d, 0, sizeof(*d));
+        d->wd = wd;
+        d->path = strdup(dirname);
+        if (!d->path)
+            Error("Failed to allocate memory for the watch list.");
+    } else if (d->whole || !whole) {
+        return d;   // Already watched; symlinked directories end here too
+    }
+    if (!whole)
+        return d;
+    d->whole = true;
+
+    DIR *dir = opendir(dirname);
+    if (!dir)
+        return d;   // Removed again; its watch goes with it
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+            continue;
+        char path[1024];
+        if (snprintf(path, sizeof(path), "%s/%s", dirname, ent->d_name) >= (int)sizeof(path))
+            continue;
+        struct stat st;
+        if (stat(path, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            WatchDirectory(watch, path, true, addfiles);
+        else if (addfiles && HasMDLExtension(ent->d_name))
+            AddChanged(watch, path);
+    }
+    closedir(dir);
+    return d;
+}
+
+// WatchFile: Watches the directory of an input named directly, for that file only.
+void WatchFile (watch_t *watch, const char *filename)
+{
+    char dirname[1024];
+    const char *slash = strrchr(filename, '/');
+    if (!slash)
+        strcpy(dirname, ".");
+    else if (slash == filename)
+        strcpy(dirname, "/");
+    else
+        snprintf(dirname, sizeof(dirname), "%.*s", (int)(slash - filename), filename);
+    watchdir_t *d = WatchDirectory(watch, dirname, false, false);
+    if (d)
+        AddInputFile(&d->files, filename);
+}
+
+// ReadWatchEvents: Queues the models that the pending inotify events name.
+void ReadWatchEvents (watch_t *watch)
+{
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len = read(watch->fd, buffer, sizeof(buffer));
+    if (len <= 0)
+        return;
+
+    for (char *p = buffer; p < buffer + len; ) {
+        const struct inotify_event *ev = (const struct inotify_event *)p;
+        p += sizeof(*ev) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+            // Events were lost; everything may have changed
+            fprintf(stderr, "Watch event queue overflowed; converting all inputs\n");
+            for (int i = 0; i < watch->numdirs; i++) {
+                if (watch->dirs[i].whole)
+                    WatchDirectory(watch, watch->dirs[i].path, true, true);
+                for (int j = 0; j < watch->dirs[i].files.count; j++)
+                    AddChanged(watch, watch->dirs[i].files.names[j]);
+            }
+            continue;
+        }
+        watchdir_t *d = FindWatch(watch, ev->wd);
+        if (!d || !ev->len)
+            continue;
+
+        char path[1024];
+        if (snprintf(path, sizeof(path), "%s/%s", d->path, ev->name) >= (int)sizeof(path))
+            continue;
+        if (ev->mask & IN_ISDIR) {
+            // A new directory may already hold models by the time it is watched
+            if (d->whole && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+                WatchDirectory(watch, path, true, true);
+            continue;
+        }
+        // Creation is followed by a close or a rename once the file is complete
+        if (!(ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+            continue;
+        if (d->whole && HasMDLExtension(ev->name)) {
+            AddChanged(watch, path);
+            continue;
+        }
+        for (int i = 0; i < d->files.count; i++) {
+            const char *name = d->files.names[i];
+            const char *slash = strrchr(name, '/');
+            if (!strcmp(slash ? slash + 1 : name, ev->name))
+                AddChanged(watch, name);
+        }
+    }
+}
+#endif
+
+// FileStamp: The modification time of st, as precisely as the platform keeps it.
+long long FileStamp (const struct stat *st)
+{
+#ifdef __linux__
+    return (long long)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#else
+    return (long long)st->st_mtime * 1000000000;
+#endif
+}
+
+int CompareWatchFiles (const void *a, const void *b)
+{
+    return strcmp(((const watchfile_t *)a)->name, ((const watchfile_t *)b)->name);
+}
+
+// PollInputs: Rescans the inputs and queues every model that is new or whose size
+// or modification time differs from the last scan. The first scan queues nothing.
+void PollInputs (watch_t *watch, qboolean first)
+{
+    filelist_t list;
+    memset(&list, 0, sizeof(list));
+    for (int i = 0; i < watch->roots.count; i++)
+        AddInput(&list, watch->roots.names[i]);
+
+    watchfile_t *files = (watchfile_t *)malloc((list.count ? list.count : 1) * sizeof(watchfile_t));
+    if (!files)
+        Error("Failed to allocate memory for the watch list.");
+    int numfiles = 0;
+    for (int i = 0; i < list.count; i++) {
+        struct stat st;
+        if (stat(list.names[i], &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(list.names[i]);
+            continue;
+        }
+        files[numfiles].name = list.names[i];   // Taken over from list
+        files[numfiles].stamp = FileStamp(&st);
+        files[numfiles].size = (long long)st.st_size;
+        numfiles++;
+    }
+    free(list.names);
+    qsort(files, numfiles, sizeof(watchfile_t), CompareWatchFiles);
+
+    for (int i = 0, j = 0; !first && i < numfiles; i++) {
+        while (j < watch->numfiles && strcmp(watch->files[j].name, files[i].name) < 0)
+            j++;
+        const watchfile_t *old = j < watch->numfiles && !strcmp(watch->files[j].name, files[i].name) ? &watch->files[j] : NULL;
+        if (!old || old->stamp != files[i].stamp || old->size != files[i].size)
+            AddChanged(watch, files[i].name);
+    }
+
+    for (int i = 0; i < watch->numfiles; i++)
+        free(watch->files[i].name);
+    free(watch->files);
+    watch->files = files;
+    watch->numfiles = numfiles;
+}
+
+// SleepMilliseconds: Sleeps for ms, or less when a signal arrives.
+void SleepMilliseconds (int ms)
+{
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+}
+
+// WaitForChanges: Blocks until models have changed and then been quiet for
+// watch_debounce ms, or until the watch is stopped.
+void WaitForChanges (watch_t *watch)
+{
+    double debounce = watch_debounce / 1000.0;
+    while (!watch_stop) {
+        double now = I_FloatTime();
+        if (watch->changed.count && now - watch->lastevent >= debounce)
+            return;
+#ifdef __linux__
+        if (watch->fd >= 0) {
+            int timeout = watch->changed.count ? (int)((watch->lastevent + debounce - now) * 1000) + 1 : -1;
+            struct pollfd pfd;
+            pfd.fd = watch->fd;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, timeout) > 0)
+                ReadWatchEvents(watch);
+            continue;
+        }
+#endif
+        SleepMilliseconds(watch_debounce);
+        if (!watch_stop)
+            PollInputs(watch, false);
+    }
+}
+
+// RunWatchRound: Converts list with the warm batch and reports the round.
+int RunWatchRound (batch_t *batch, filelist_t *list)
+{
+    qsort(list->names, list->count, sizeof(char *), CompareNames);
+    stats_t *stats = (stats_t *)calloc(list->count ? list->count : 1, sizeof(stats_t));
+    if (!stats)
+        Error("Failed to allocate worker state.");
+
+    double start = I_FloatTime();
+    int failed = RunBatch(batch, list, stats);
+    double seconds = I_FloatTime() - start;
+
+    if (stats_mode != STATS_NONE)
+        ReportStats(stdout, list, stats, seconds);
+    if (stats_mode != STATS_JSON)
+        printf("Converted %d of %d models in %.1f ms (%d failed).\n", list->count - failed, list->count, seconds * 1000, failed);
+    fflush(stdout);
+    free(stats);
+    return failed;
+}
+
+// WatchInputs: Converts list, then reconverts the models that change under the
+// inputs until SIGINT or SIGTERM. inputs are the command-line inputs list came from.
+int WatchInputs (filelist_t *list, char **inputs, int numinputs, int threads)
+{
+    watch_t watch;
+    memset(&watch, 0, sizeof(watch));
+    watch.fd = -1;
+    for (int i = 0; i < numinputs; i++) {
+        if (inputs[i][0] == '@')
+            AddInputResponseFile(&watch.roots, inputs[i] + 1);
+        else
+            AddInputFile(&watch.roots, inputs[i]);
+    }
+
+    // Watches go up before the first round, so saves made during it are not lost
+#ifdef __linux__
+    if (watch_mode == WATCH_NOTIFY) {
+        watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch.fd < 0)
+            fprintf(stderr, "inotify is unavailable (%s); polling instead\n", strerror(errno));
+    }
+    for (int i = 0; watch.fd >= 0 && i < watch.roots.count; i++) {
+        struct stat st;
+        if (stat(watch.roots.names[i], &st) == 0 && S_ISDIR(st.st_mode))
+            WatchDirectory(&watch, watch.roots.names[i], true, false);
+        else
+            WatchFile(&watch, watch.roots.names[i]);
+    }
+#endif
+    if (watch.fd < 0)
+        PollInputs(&watch, true);
+
+    signal(SIGINT, WatchSignal);
+    signal(SIGTERM, WatchSignal);
+
+    batch_t batch;
+    InitBatch(&batch, threads);
+    StartBatchWriters();
+    RunWatchRound(&batch, list);
+
+    if (watch.fd >= 0)
+        printf("Watching %d directories for changes (inotify, %d ms debounce). Press Ctrl-C to stop.\n", watch.numdirs, watch_debounce);
+    else
+        printf("Watching %d models for changes (polling every %d ms). Press Ctrl-C to stop.\n", watch.numfiles, watch_debounce);
+    fflush(stdout);
+
+    while (!watch_stop) {
+        WaitForChanges(&watch);
+        if (watch_stop)
+            break;
+        RunWatchRound(&batch, &watch.changed);
+        ClearFileList(&watch.changed);
+    }
+
+    StopWriters(&write_queue);
+    FreeBatch(&batch);
+#ifdef __linux__
+    if (watch.fd >= 0)
+        close(watch.fd);
+    for (int i = 0; i < watch.numdirs; i++) {
+        free(watch.dirs[i].path);
+        ClearFileList(&watch.dirs[i].files);
+        free(watch.dirs[i].files.names);
+    }
+    free(watch.dirs);
+#endif
+    for (int i = 0; i < watch.numfiles; i++)
+        free(watch.files[i].name);
+    free(watch.files);
+    ClearFileList(&watch.roots);
+    ClearFileList(&watch.changed);
+    free(watch.roots.names);
+    free(watch.changed.names);
+    printf("Stopped watching.\n");
+    return 0;
+}
+
+
+// OptionsHash: Hashes every option that changes what is written, so --incremental
+// redoes a model when they change.
+unsigned long long OptionsHash (void)
+{
+    char options[256];
+    snprintf(options, sizeof(options), "v%d rle%d mdarle%d indexjson%d normals%d container%d%d skins%d frames%d skinformat%d%d resample%g formats=",
+             CACHE_VERSION, output_rle, output_mda_rle, output_index_json, normal_mode, output_container,
+             output_container_skins, extract_skins, extract_frames, skin_format, output_fullbright, resample_rate);
+    unsigned long long hash = HashBytes(options, strlen(options), FNV_OFFSET);
+    // In table order, so the order formats were given in does not matter
+    for (int i = 0; i < NUM_OUTPUT_BACKENDS; i++) {
+        for (int j = 0; j < num_frame_backends; j++) {
+            if (frame_backends[j] == output_backends[i])
+                hash = HashBytes(output_backends[i]->name, strlen(output_backends[i]->name) + 1, hash);
+        }
+    }
+    hash = HashBytes("names=", 6, hash);
+    hash = HashBytes(loaded_palette, sizeof(loaded_palette), hash);
+    if (frame_names)
+        hash = HashBytes(frame_names, strlen(frame_names), hash);
+    return HashBytes(frame_ranges, num_frame_ranges * sizeof(framerange_t), hash);
+}
+
+// ParseMemorySize: Parses a size such as 512k, 64m or 2g; 0 if it is not one.
+size_t ParseMemorySize (const char *s)
+{
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(s, &end, 10);
+    int shift = 0;
+    if (end == s || errno || *s == '-')
+        return 0;
+    switch (*end) {
+    case 'k': case 'K': shift = 10; end++; break;
+    case 'm': case 'M': shift = 20; end++; break;
+    case 'g': case 'G': shift = 30; end++; break;
+    }
+    if (*end || value > (unsigned long long)SIZE_MAX >> shift)
+        return 0;
+    return (size_t)value << shift;
+}
+
+void Usage (char *progname)
+{
+    fprintf(stderr, "Usage: %s [options] <input_mdl_file | directory | @listfile> ...\n", progname);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --threads N         Use up to N threads for models and their frames (default: one per CPU)\n");
+    fprintf(stderr, "  --writers N         Write loose outputs on N threads while decoding goes on (default: 4,\n");
+    fprintf(stderr, "                      0 writes each output before the next is decoded)\n");
+    fprintf(stderr, "  --write-queue N     Queue at most N outputs for the writers (default: 4 per writer)\n");
+    fprintf(stderr, "  --container         Write all frames of a model into one <base>.pak instead of one .tri each\n");
+    fprintf(stderr, "  --container-skins   Like --container, and put the skins in the .pak too\n");
+    fprintf(stderr, "  --outdir DIR        Write the outputs into DIR (created if needed) instead of next to each input\n");
+    fprintf(stderr, "  --outdir-layout=L   flat (default), model (DIR/<name>/) or hashed (DIR/<hh>/<name>/ over 256 shards)\n");
+    fprintf(stderr, "  --rle               Write ByteRun1 (PackBits) compressed .lbm skins\n");
+    fprintf(stderr, "  --stdout            Stream all outputs to stdout as a tar archive (logs go to stderr)\n");
+    fprintf(stderr, "  --format LIST       Frame formats to write, any of tri, glb, mda and index, e.g. tri,glb (default: tri)\n");
+    fprintf(stderr, "  --mda[=rle]         Same as --format mda: all frames as one delta-coded <base>.mda\n");
+    fprintf(stderr, "  --glb               Same as --format glb: one indexed <base>.glb with a morph target per frame\n");
+    fprintf(stderr, "  --index[=json]      Same as --format index: a <base>.mdi table of frame names, groups, intervals,\n");
+    fprintf(stderr, "                      bounds and offsets, read from the frame headers (=json adds <base>_index.json)\n");
+    fprintf(stderr, "  --resample HZ       Write tri and glb frames at HZ per second, blended from the frames and their\n");
+    fprintf(stderr, "                      group intervals (single frames last 0.1 s)\n");
+    fprintf(stderr, "  --normals=MODE      Vertex normals for .tri and .glb: table (lightnormalindex, default),\n");
+    fprintf(stderr, "                      smooth (recomputed from the faces) or none\n");
+    fprintf(stderr, "  --skin-format=F     Skin output: lbm (paletted, default), tga or rgba (raw 32-bit pixels)\n");
+    fprintf(stderr, "  --fullbright        With tga or rgba, also write <base>_skin<i>_luma with the fullbright pixels\n");
+    fprintf(stderr, "  --palette FILE      Use a 768-byte palette.lmp instead of the built-in Quake palette\n");
+    fprintf(stderr, "  --max-memory SIZE   Fail a model rather than let one worker hold more than SIZE bytes\n");
+    fprintf(stderr, "                      (e.g. 256m), counting its outputs waiting in the write queue;\n");
+    fprintf(stderr, "                      frame threads are cut down to fit (default: no limit)\n");
+    fprintf(stderr, "  --incremental       Skip models and outputs unchanged since the last run (<base>.mdlcache)\n");
+    fprintf(stderr, "  --skins-only        Extract only the skins\n");
+    fprintf(stderr, "  --frames-only       Extract only the frames\n");
+    fprintf(stderr, "  --frames LIST       Extract only frames at these table indices, e.g. 0,5-10,20-\n");
+    fprintf(stderr, "  --frame-name GLOBS  Extract only frames whose name matches one of these globs, e.g. run*,pain?\n");
+    fprintf(stderr, "  --probe[=json]      Print one inventory record per model (TSV or JSON lines) and write nothing\n");
+    fprintf(stderr, "  -v, --verbose       Log every skin and frame\n");
+    fprintf(stderr, "  --stats[=json]      Report time and bytes per phase for each model and the batch\n");
+    fprintf(stderr, "  --bench[=SPEC]      Benchmark synthetic models instead of converting inputs; SPEC is\n");
+    fprintf(stderr, "                      key=value,... over verts, tris, frames, group, skins, skingroup,\n");
+    fprintf(stderr, "                      skin (WxH), models, iterations, seed and dir\n");
+    fprintf(stderr, "  --watch[=poll]      Convert the inputs, then reconvert each model that changes until\n");
+    fprintf(stderr, "                      interrupted (inotify on Linux; =poll rescans instead)\n");
+    fprintf(stderr, "  --debounce MS       With --watch, wait until changes are MS quiet (default: 50)\n");
+    fprintf(stderr, "  --name NAME         Output base name for a model read from stdin as \"-\" (default: stdin)\n");
+}
+
+int main (int argc, char **argv)
+{
+    char *bench_spec = NULL;
+    filelist_t list;
+    memset(&list, 0, sizeof(list));
+
+    // Every output would be garbage; refuse rather than write it
+    if (!MDL_CheckByteOrder()) {
+        fprintf(stderr, "This build assumes %s-endian byte order, but the host is not; rebuild it here.\n",
+                MDL_BIG_ENDIAN ? "big" : "little");
+        return 1;
+    }
+
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            numthreads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--writers") && i + 1 < argc) {
+            output_writers = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--write-queue") && i + 1 < argc) {
+            output_queue_depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--container")) {
+            output_container = true;
+        } else if (!strcmp(argv[i], "--container-skins")) {
+            output_container = true;
+            output_container_skins = true;
+        } else if (!strcmp(argv[i], "--outdir") && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (!strcmp(argv[i], "--outdir-layout=flat")) {
+            output_dir_layout = OUTDIR_FLAT;
+        } else if (!strcmp(argv[i], "--outdir-layout=model")) {
+            output_dir_layout = OUTDIR_MODEL;
+        } else if (!strcmp(argv[i], "--outdir-layout=hashed")) {
+            output_dir_layout = OUTDIR_HASHED;
+        } else if (!strcmp(argv[i], "--rle")) {
+            output_rle = true;
+        } else if (!strcmp(argv[i], "--stdout")) {
+            output_stdout = true;
+        } else if (!strcmp(argv[i], "--format") && i + 1 < argc) {
+            ParseFormats(argv[++i]);
+        } else if (!strcmp(argv[i], "--mda")) {
+            EnableFormat("mda", 3);
+        } else if (!strcmp(argv[i], "--mda=rle")) {
+            EnableFormat("mda", 3);
+            output_mda_rle = true;
+        } else if (!strcmp(argv[i], "--glb")) {
+            EnableFormat("glb", 3);
+        } else if (!strcmp(argv[i], "--index")) {
+            EnableFormat("index", 5);
+        } else if (!strcmp(argv[i], "--index=json")) {
+            EnableFormat("index", 5);
+            output_index_json = true;
+        } else if (!strcmp(argv[i], "--resample") && i + 1 < argc) {
+            resample_rate = (float)atof(argv[++i]);
+            if (!(resample_rate > 0 && resample_rate <= 1000)) {
+                fprintf(stderr, "--resample takes a rate above 0 and up to 1000 Hz.\n");
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--normals=table")) {
+            normal_mode = NORMALS_TABLE;
+        } else if (!strcmp(argv[i], "--normals=smooth")) {
+            normal_mode = NORMALS_SMOOTH;
+        } else if (!strcmp(argv[i], "--normals=none")) {
+            normal_mode = NORMALS_NONE;
+        } else if (!strcmp(argv[i], "--skin-format=lbm")) {
+            skin_format = SKIN_LBM;
+        } else if (!strcmp(argv[i], "--skin-format=tga")) {
+            skin_format = SKIN_TGA;
+        } else if (!strcmp(argv[i], "--skin-format=rgba")) {
+            skin_format = SKIN_RGBA;
+        } else if (!strcmp(argv[i], "--fullbright")) {
+            output_fullbright = true;
+        } else if (!strcmp(argv[i], "--palette") && i + 1 < argc) {
+            LoadPalette(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-memory") && i + 1 < argc) {
+            max_memory = ParseMemorySize(argv[++i]);
+            if (!max_memory) {
+                fprintf(stderr, "--max-memory takes a size such as 65536, 512k, 64m or 2g.\n");
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--incremental")) {
+            output_incremental = true;
+        } else if (!strcmp(argv[i], "--skins-only")) {
+            extract_frames = false;
+        } else if (!strcmp(argv[i], "--frames-only")) {
+            extract_skins = false;
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            ParseFrameRanges(argv[++i]);
+        } else if (!strcmp(argv[i], "--frame-name") && i + 1 < argc) {
+            frame_names = argv[++i];
+        } else if (!strcmp(argv[i], "--probe")) {
+            probe_mode = PROBE_TSV;
+        } else if (!strcmp(argv[i], "--probe=json")) {
+            probe_mode = PROBE_JSON;
+        } else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verbose")) {
+            verbose = true;
+        } else if (!strcmp(argv[i], "--stats")) {
+            stats_mode = STATS_TEXT;
+        } else if (!strcmp(argv[i], "--stats=json")) {
+            stats_mode = STATS_JSON;
+        } else if (!strcmp(argv[i], "--bench")) {
+            bench_spec = "";
+        } else if (!strncmp(argv[i], "--bench=", 8)) {
+            bench_spec = argv[i] + 8;
+        } else if (!strcmp(argv[i], "--watch")) {
+#ifdef __linux__
+            watch_mode = WATCH_NOTIFY;
+#else
+            watch_mode = WATCH_POLL;
+#endif
+        } else if (!strcmp(argv[i], "--watch=poll")) {
+            watch_mode = WATCH_POLL;
+        } else if (!strcmp(argv[i], "--debounce") && i + 1 < argc) {
+            watch_debounce = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--name") && i + 1 < argc) {
+            stdin_name = argv[++i];
+        } else if (!strcmp(argv[i], "--")) {
+            i++;
+            break;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            Usage(argv[0]);
+            return 1;
+        } else {
+            break;
+        }
+    }
+    int firstinput = i;
+    for ( ; i < argc; i++)
+        AddInput(&list, argv[i]);
+    if (!num_frame_backends)
+        EnableFormat("tri", 3);
+
+    BuildSkinPalette(&skin_palette, loaded_palette, skin_format == SKIN_TGA);
+
+    int threads = numthreads > 0 ? numthreads : DefaultThreadCount();
+    if (bench_spec)
+        return Benchmark(bench_spec, threads);
+
+    if (list.count == 0 && !(watch_mode != WATCH_NONE && firstinput < argc)) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (!extract_skins && !extract_frames) {
+        fprintf(stderr, "--skins-only and --frames-only cannot be combined.\n");
+        return 1;
+    }
+    if (!extract_frames && (num_frame_ranges || frame_names)) {
+        fprintf(stderr, "--frames and --frame-name select frames; they cannot be combined with --skins-only.\n");
+        return 1;
+    }
+    if (resample_rate > 0) {
+        for (int j = 0; j < num_frame_backends; j++) {
+            if (!frame_backends[j]->frame) {
+                fprintf(stderr, "--resample blends decoded frames; %s is built from the stored frames and cannot be combined with it.\n",
+                        frame_backends[j]->name);
+                return 1;
+            }
+        }
+        if (!extract_frames) {
+            fprintf(stderr, "--resample writes frames; it cannot be combined with --skins-only.\n");
+            return 1;
+        }
+    }
+    if (output_fullbright && skin_format == SKIN_LBM) {
+        fprintf(stderr, "--fullbright writes true-color masks; use it with --skin-format=tga or rgba.\n");
+        return 1;
+    }
+    if (output_stdout && output_incremental) {
+        fprintf(stderr, "--incremental keeps outputs on disk; it cannot be combined with --stdout.\n");
+        return 1;
+    }
+    if (watch_mode != WATCH_NONE && (output_stdout || probe_mode != PROBE_NONE)) {
+        fprintf(stderr, "--watch converts models as they change; it cannot be combined with --stdout or --probe.\n");
+        return 1;
+    }
+    if (watch_debounce < 1 || watch_debounce > 60000) {
+        fprintf(stderr, "--debounce takes 1 to 60000 milliseconds.\n");
+        return 1;
+    }
+    if (output_dir && (output_stdout || probe_mode != PROBE_NONE)) {
+        fprintf(stderr, "--outdir places output files; it cannot be combined with --stdout or --probe.\n");
+        return 1;
+    }
+    if (output_stdout && output_container) {
+        fprintf(stderr, "--stdout already writes a single archive; it cannot be combined with --container.\n");
+        return 1;
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    FILE *logout = output_stdout ? stderr : stdout;
+
+    options_hash = OptionsHash();
+
+    // Directory listings come back in filesystem order; sort for repeatable runs
+    qsort(list.names, list.count, sizeof(char *), CompareNames);
+    if (output_dir) {
+        if (!CheckOutputNames(&list))
+            return 1;
+        OpenOutputDir(output_dir);
+    }
+    log_quiet = stats_mode == STATS_JSON;
+
+    int failed;
+    if (watch_mode != WATCH_NONE) {
+        read_input = true;
+        failed = WatchInputs(&list, argv + firstinput, argc - firstinput, threads);
+    } else if (probe_mode != PROBE_NONE) {
+        // The records are the whole output: no summary or statistics
+        if (probe_mode == PROBE_TSV)
+            printf("file\tstatus\tversion\tskins\tskinwidth\tskinheight\tverts\ttris\tframes\tentries\tflags\tsynctype\tfilesize\tdecodedsize\tmessage\n");
+        failed = ConvertBatch(&list, threads, NULL);
+    } else {
+        stats_t *stats = (stats_t *)calloc(list.count, sizeof(stats_t));
+        if (!stats)
+            Error("Failed to allocate worker state.");
+
+        double start = I_FloatTime();
+        failed = ConvertBatch(&list, threads, stats);
+        double seconds = I_FloatTime() - start;
+
+        if (output_stdout)
+            FinishTarStream(stdout);
+
+        if (stats_mode != STATS_NONE)
+            ReportStats(logout, &list, stats, seconds);
+        free(stats);
+
+        // A JSON report is kept as the only thing on logout
+        if (stats_mode != STATS_JSON) {
+            if (list.count > 1)
+                fprintf(logout, "\nConverted %d of %d models (%d failed).\n", list.count - failed, list.count, failed);
+            else if (!failed && output_stdout)
+                fprintf(logout, "\nMDL reverse engineering complete. Outputs were written to stdout as a tar stream.\n");
+            else if (!failed)
+                fprintf(logout, "\nMDL reverse engineering complete. Check the output directory for .lbm and .tri files.\n");
+        }
+    }
 
-	printf("\nMDL reverse engineering complete. Check the output directory for .lbm and .tri files.\n");
+    for (i = 0; i < list.count; i++)
+        free(list.names[i]);
+    free(list.names);
 
-	return 0;
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,755 @@
+// mdllib.c -- Quake MDL parsing library (libmdl.a); see mdllib.h
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h> // For va_list
+#include <math.h>   // For sqrtf
+#include <limits.h> // For INT_MAX
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h> // For _mm_shuffle_epi8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "mdllib.h"
+
+// --- Math Helper Functions (Simplified from Quake's mathlib.h) ---
+static void VectorSubtract(vec3_t va, vec3_t vb, vec3_t vc) {
+    vc[0] = va[0] - vb[0]; vc[1] = va[1] - vb[1]; vc[2] = va[2] - vb[2];
+}
+
+static void CrossProduct(vec3_t v1, vec3_t v2, vec3_t cross) {
+    cross[0] = v1[1] * v2[2] - v1[2] * v2[1];
+    cross[1] = v1[2] * v2[0] - v1[0] * v2[2];
+    cross[2] = v1[0] * v2[1] - v1[1] * v2[0];
+}
+
+static float VectorLength(vec3_t v) {
+    return sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]); // Using sqrtf for float
+}
+
+static void VectorNormalize(vec3_t v) {
+    float length = VectorLength(v);
+    if (length == 0) {
+        v[0] = v[1] = v[2] = 0;
+        return;
+    }
+    v[0] /= length; v[1] /= length; v[2] /= length;
+}
+
+
+// --- Errors ---
+static const char *mdl_error_strings[NUM_MDL_ERRORS] = {
+    "no error",
+    "truncated model",
+    "not a Quake MDL",
+    "invalid header",
+    "invalid triangle",
+    "invalid frame",
+    "out of memory",
+    "frame index out of range",
+    "invalid skin",
+};
+
+const char *MDL_ErrorString (mdlerror_t error)
+{
+    if ((unsigned)error >= NUM_MDL_ERRORS)
+        return "unknown error";
+    return mdl_error_strings[error];
+}
+
+// SetError: Records a formatted message for the caller and returns the code.
+static mdlerror_t SetError (mdl_t *model, mdlerror_t error, const char *fmt, ...)
+{
+    va_list argptr;
+    va_start(argptr, fmt);
+    vsnprintf(model->error, sizeof(model->error), fmt, argptr);
+    va_end(argptr);
+    return error;
+}
+
+// --- Allocators ---
+static void *DefaultAlloc (void *opaque, size_t size)
+{
+    (void)opaque;
+    return malloc(size);
+}
+
+static void DefaultFree (void *opaque, void *ptr)
+{
+    (void)opaque;
+    free(ptr);
+}
+
+static const mdlallocator_t default_allocator = { DefaultAlloc, DefaultFree, NULL };
+
+static void *ModelAlloc (mdl_t *model, size_t size)
+{
+    return model->allocator.alloc(model->allocator.opaque, size ? size : 1);
+}
+
+static void ModelFree (mdl_t *model, void *ptr)
+{
+    if (ptr && model->allocator.free)
+        model->allocator.free(model->allocator.opaque, ptr);
+}
+
+// --- Byte Order ---
+
+// CopyLongs: The conversion on a host whose byte order matches the data.
+static void CopyLongs (void *out, const void *in, size_t count)
+{
+    if (out != in)
+        memmove(out, in, count * 4);
+}
+
+void MDL_SwapLongs (void *out, const void *in, size_t count)
+{
+    byte        *o = (byte *)out;
+    const byte  *i = (const byte *)in;
+    size_t      n = 0;
+
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+    for ( ; n + 4 <= count; n += 4, i += 16, o += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)i);
+        _mm_storeu_si128((__m128i *)o, _mm_shuffle_epi8(v, shuffle));
+    }
+#elif defined(__SSE2__)
+    for ( ; n + 4 <= count; n += 4, i += 16, o += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)i);
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)); // Swap bytes within 16-bit words
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1));               // Swap the 16-bit words
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1));
+        _mm_storeu_si128((__m128i *)o, v);
+    }
+#elif defined(__ARM_NEON)
+    for ( ; n + 4 <= count; n += 4, i += 16, o += 16)
+        vst1q_u8(o, vrev32q_u8(vld1q_u8(i)));
+#endif
+    for ( ; n < count; n++, i += 4, o += 4) {
+        byte b0 = i[0], b1 = i[1];
+        o[0] = i[3]; o[1] = i[2];
+        o[2] = b1;   o[3] = b0;
+    }
+}
+
+void MDL_LittleLongs (void *out, const void *in, size_t count)
+{
+#if MDL_BIG_ENDIAN
+    MDL_SwapLongs(out, in, count);
+#else
+    CopyLongs(out, in, count);
+#endif
+}
+
+void MDL_BigLongs (void *out, const void *in, size_t count)
+{
+#if MDL_BIG_ENDIAN
+    CopyLongs(out, in, count);
+#else
+    MDL_SwapLongs(out, in, count);
+#endif
+}
+
+qboolean MDL_CheckByteOrder (void)
+{
+    const unsigned int one = 1;
+    byte first;
+    memcpy(&first, &one, 1);
+    return (first == 0) == MDL_BIG_ENDIAN;
+}
+
+// --- Bounds-Checked Views ---
+// The parser never reads past model->size: every view is checked before it is
+// used, and array sizes are checked before they are multiplied out.
+
+// Take: Points *view at count bytes at *pos and advances past them.
+static mdlerror_t Take (mdl_t *model, size_t *pos, size_t count, const char *what, const void **view)
+{
+    if (*pos > model->size || count > model->size - *pos)
+        return SetError(model, MDL_ERR_TRUNCATED, "truncated: %s needs %zu bytes at offset %zu, model is %zu bytes",
+                        what, count, *pos, model->size);
+    *view = model->data + *pos;
+    *pos += count;
+    return MDL_OK;
+}
+
+// TakeArray: Like Take for count elements, rejecting negative counts and sizes
+// that would overflow before they reach the bounds check.
+static mdlerror_t TakeArray (mdl_t *model, size_t *pos, int count, size_t elemsize, const char *what, const void **view)
+{
+    if (count < 0 || *pos > model->size || (size_t)count > (model->size - *pos) / elemsize)
+        return SetError(model, MDL_ERR_TRUNCATED, "truncated or corrupt: %d %s of %zu bytes at offset %zu, model is %zu bytes",
+                        count, what, elemsize, *pos, model->size);
+    return Take(model, pos, (size_t)count * elemsize, what, view);
+}
+
+// TakeLittleLong: Reads a little-endian 4-byte integer at *pos.
+static mdlerror_t TakeLittleLong (mdl_t *model, size_t *pos, const char *what, int *out)
+{
+    const void *view = NULL;
+    mdlerror_t error = Take(model, pos, 4, what, &view);
+    if (error == MDL_OK) {
+        const byte *b = (const byte *)view;
+        *out = (int)((unsigned)b[0] | ((unsigned)b[1] << 8) | ((unsigned)b[2] << 16) | ((unsigned)b[3] << 24));
+    }
+    return error;
+}
+
+// --- Header ---
+
+// MinimumModelSize: Smallest model the header's counts allow: every skin and frame
+// entry is at least a single skin or single frame (groups only add to that).
+// Returns false if that size does not fit in 64 bits, which no file can hold.
+static qboolean MinimumModelSize (const mdl_header_t *header, unsigned long long *minimum)
+{
+    unsigned long long skinsize, framesize, skins, stverts, tris, frames, total;
+    if (__builtin_mul_overflow((unsigned long long)header->skinwidth, (unsigned long long)header->skinheight, &skinsize)
+        || __builtin_mul_overflow((unsigned long long)header->numverts, sizeof(trivertx_t), &framesize)
+        || __builtin_add_overflow(framesize, 4 + sizeof(daliasframe_t), &framesize)
+        || __builtin_mul_overflow((unsigned long long)header->numskins, skinsize + 4, &skins)
+        || __builtin_mul_overflow((unsigned long long)header->numverts, sizeof(stvert_t), &stverts)
+        || __builtin_mul_overflow((unsigned long long)header->numtris, sizeof(dtriangle_t), &tris)
+        || __builtin_mul_overflow((unsigned long long)header->numframes, framesize, &frames)
+        || __builtin_add_overflow(skins, sizeof(mdl_header_t), &total)
+        || __builtin_add_overflow(total, stverts, &total)
+        || __builtin_add_overflow(total, tris, &total)
+        || __builtin_add_overflow(total, frames, &total))
+        return false;
+    *minimum = total;
+    return true;
+}
+
+mdlerror_t MDL_ReadHeader (mdl_t *model, const void *data, size_t size)
+{
+    mdl_header_t *header = &model->header;
+
+    model->data = (const byte *)data;
+    model->size = size;
+    model->error[0] = '\0';
+    if (size < sizeof(*header)) {
+        memset(header, 0, sizeof(*header));
+        return SetError(model, MDL_ERR_TRUNCATED, "truncated: the header needs %zu bytes, model is %zu bytes",
+                        sizeof(*header), size);
+    }
+	// The on-disk header matches mdl_header_t field for field (all 4-byte
+	// little-endian values), so it is converted out of the buffer in one go.
+	MDL_LittleLongs(header, data, sizeof(*header) / 4);
+
+	if (header->ident != IDPOLYHEADER || header->version != ALIAS_VERSION) {
+		return SetError(model, MDL_ERR_IDENT, "Invalid MDL file: Header ID (0x%X) or Version (%d) mismatch. Expected IDPO (0x%X) and version %d.",
+                        header->ident, header->version, IDPOLYHEADER, ALIAS_VERSION);
+	}
+    if (header->skinwidth < 0 || header->skinheight < 0 || header->numverts < 0 || header->numtris < 0) {
+        return SetError(model, MDL_ERR_HEADER, "Invalid MDL file: negative skin size (%dx%d), vertex count (%d) or triangle count (%d).",
+                        header->skinwidth, header->skinheight, header->numverts, header->numtris);
+    }
+    if (header->numskins < 0 || header->numframes < 0) {
+        return SetError(model, MDL_ERR_HEADER, "Invalid MDL file: negative skin count (%d) or frame count (%d).",
+                        header->numskins, header->numframes);
+    }
+    if (header->skinwidth > 0 && header->skinheight > INT_MAX / header->skinwidth) {
+        return SetError(model, MDL_ERR_HEADER, "Invalid MDL file: skin size %dx%d is too large.",
+                        header->skinwidth, header->skinheight);
+    }
+    // A truncated file, or a corrupt header with absurd counts, is rejected from
+    // the header alone, before anything is allocated or walked
+    unsigned long long minimum;
+    if (!MinimumModelSize(header, &minimum)) {
+        return SetError(model, MDL_ERR_HEADER, "Invalid MDL file: header counts overflow the model size (%d skins %dx%d, %d verts, %d tris, %d frames).",
+                        header->numskins, header->skinwidth, header->skinheight,
+                        header->numverts, header->numtris, header->numframes);
+    }
+    if (minimum > size) {
+        return SetError(model, MDL_ERR_TRUNCATED, "Invalid MDL file: header needs at least %llu bytes (%d skins %dx%d, %d verts, %d tris, %d frames), file has %zu.",
+                        minimum, header->numskins, header->skinwidth, header->skinheight,
+                        header->numverts, header->numtris, header->numframes, size);
+    }
+    return MDL_OK;
+}
+
+mdlerror_t MDL_CheckTriangles (mdl_t *model)
+{
+    const mdl_header_t *header = &model->header;
+    for (int i = 0; i < header->numtris; i++) {
+        for (int j = 0; j < 3; j++) {
+            int v = model->triangles[i].vertindex[j];
+            if (v < 0 || v >= header->numverts)
+                return SetError(model, MDL_ERR_TRIANGLE, "Triangle %d references vertex %d, model only has %d vertices.",
+                                i, v, header->numverts);
+        }
+    }
+    return MDL_OK;
+}
+
+// --- Skin Table ---
+// A skin entry is a type word and either one image, or a group: a count, the
+// group's interval table and that many images. Like frames, every image gets a
+// table entry, so skins can be reached by offset without walking the others.
+
+// WalkSkins: Walks the skin entries at *pos and counts the skins. If table is not
+// NULL every skin is recorded in it.
+static mdlerror_t WalkSkins (mdl_t *model, size_t *pos, mdlskin_t *table, int *numskins)
+{
+    size_t skinsize = (size_t)model->header.skinwidth * model->header.skinheight;
+    const void *view = NULL;
+    mdlerror_t error;
+    int count = 0;
+
+    for (int i = 0; i < model->header.numskins; i++) {
+        int type;
+        if ((error = TakeLittleLong(model, pos, "skin type", &type)) != MDL_OK)
+            return error;
+
+        if (type == ALIAS_SKIN_SINGLE) {
+            if (table) {
+                mdlskin_t *skin = &table[count];
+                skin->offset = *pos;
+                skin->type = ALIAS_SKIN_SINGLE;
+                skin->group = i;
+                skin->sub = -1;
+                skin->interval = 0;
+            }
+            if ((error = Take(model, pos, skinsize, "skin", &view)) != MDL_OK)
+                return error;
+            count++;
+        } else if (type == ALIAS_SKIN_GROUP) {
+            int numgroupskins;
+            if ((error = TakeLittleLong(model, pos, "skin group", &numgroupskins)) != MDL_OK)
+                return error;
+            // Same bound as frame groups
+            if (numgroupskins <= 0 || numgroupskins > 10000)
+                return SetError(model, MDL_ERR_SKIN, "Suspicious number of sub-skins (%d) in skin group %d (expected 1 to 10000).",
+                                numgroupskins, i);
+            if ((error = TakeArray(model, pos, numgroupskins, sizeof(float), "skin intervals", &view)) != MDL_OK)
+                return error;
+            const byte *intervals = (const byte *)view;
+            size_t offset = *pos;
+            if (skinsize && (size_t)numgroupskins > (model->size - offset) / skinsize)
+                return SetError(model, MDL_ERR_TRUNCATED, "truncated: skin group %d needs %d skins of %zu bytes at offset %zu, model is %zu bytes",
+                                i, numgroupskins, skinsize, offset, model->size);
+            if ((error = Take(model, pos, (size_t)numgroupskins * skinsize, "group skins", &view)) != MDL_OK)
+                return error;
+            if (table) {
+                for (int j = 0; j < numgroupskins; j++) {
+                    mdlskin_t *skin = &table[count + j];
+                    skin->offset = offset + (size_t)j * skinsize;
+                    skin->type = ALIAS_SKIN_GROUP;
+                    skin->group = i;
+                    skin->sub = j;
+                    MDL_LittleLongs(&skin->interval, intervals + j * sizeof(float), 1);
+                }
+            }
+            count += numgroupskins;
+        } else {
+            return SetError(model, MDL_ERR_SKIN, "Unknown skin type %d for skin %d. File may be corrupted or an unsupported format.",
+                            type, i);
+        }
+    }
+    *numskins = count;
+    return MDL_OK;
+}
+
+// --- Frame Table ---
+// Every frame's position follows from numverts and the group sizes, so one cheap
+// pass over the frame types builds a table of all frames (group sub-frames get an
+// entry each). Frames can then be decoded independently and in parallel.
+
+// SetFrame: Fills in the table entry for the frame whose daliasframe_t is at offset.
+static void SetFrame (const mdl_t *model, mdlframe_t *frame, size_t offset, int type, int group, int sub, float interval)
+{
+    const daliasframe_t *frame_info = (const daliasframe_t *)(model->data + offset);
+
+    frame->offset = offset;
+    frame->type = type;
+    frame->group = group;
+    frame->sub = sub;
+    memcpy(frame->name, frame_info->name, 16);
+    frame->name[16] = '\0';
+    frame->interval = interval;
+}
+
+// WalkFrames: Walks the frame entries at *pos, touching only the frame type words
+// and group headers, and counts the frames. If table is not NULL the position of
+// every frame is recorded in it.
+static mdlerror_t WalkFrames (mdl_t *model, size_t *pos, mdlframe_t *table, int *numframes)
+{
+    size_t framesize = sizeof(daliasframe_t) + (size_t)model->header.numverts * sizeof(trivertx_t);
+    const void *view = NULL;
+    mdlerror_t error;
+    int count = 0;
+
+    // header.numframes counts frame entries, as in Quake: a group is one entry
+    for (int i = 0; i < model->header.numframes; i++) {
+        int frame_type_int; // The frame type (ALIAS_SINGLE or ALIAS_GROUP)
+        if ((error = TakeLittleLong(model, pos, "frame type", &frame_type_int)) != MDL_OK)
+            return error;
+
+        if (frame_type_int == ALIAS_SINGLE) {
+            size_t offset = *pos;
+            if ((error = Take(model, pos, framesize, "frame", &view)) != MDL_OK)
+                return error;
+            if (table)
+                SetFrame(model, &table[count], offset, ALIAS_SINGLE, i, -1, 0);
+            count++;
+        } else if (frame_type_int == ALIAS_GROUP) {
+            if ((error = Take(model, pos, sizeof(daliasgroup_t), "frame group", &view)) != MDL_OK)
+                return error;
+
+            // The actual number of frames for the group is in daliasgroup_t.numframes.
+            // Based on flame.mdl's behavior, it appears to be Little-Endian despite modelgen.c.
+            int actual_group_numframes;
+            MDL_LittleLongs(&actual_group_numframes, view, 1);
+
+            // Sanity check for numframes to prevent large erroneous reads
+            if (actual_group_numframes <= 0 || actual_group_numframes > 10000) { // Arbitrary but large upper bound
+                return SetError(model, MDL_ERR_FRAME, "Suspicious number of sub-frames (%d) detected in frame group. File might be corrupted or an unsupported format (expected 1 to 10000).", actual_group_numframes);
+            }
+            // The whole group must fit in what is left of the model
+            if ((size_t)actual_group_numframes > (model->size - *pos) / (sizeof(float) + framesize))
+                return SetError(model, MDL_ERR_TRUNCATED, "truncated: frame group %d needs %d frames of %zu bytes at offset %zu, model is %zu bytes",
+                                i, actual_group_numframes, framesize, *pos, model->size);
+
+            // Group frame intervals (timing information, not geometry) go into the table
+            if ((error = TakeArray(model, pos, actual_group_numframes, sizeof(float), "frame intervals", &view)) != MDL_OK)
+                return error;
+            const byte *intervals = (const byte *)view;
+
+            for (int j = 0; j < actual_group_numframes; j++) {
+                size_t offset = *pos;
+                if ((error = Take(model, pos, framesize, "group frame", &view)) != MDL_OK)
+                    return error;
+                if (table) {
+                    float interval;
+                    MDL_LittleLongs(&interval, intervals + j * sizeof(float), 1);
+                    SetFrame(model, &table[count], offset, ALIAS_GROUP, i, j, interval);
+                }
+                count++;
+            }
+        } else {
+            return SetError(model, MDL_ERR_FRAME, "Unknown frame type encountered: %d. File may be corrupted or an unsupported format.", frame_type_int);
+        }
+    }
+    *numframes = count;
+    return MDL_OK;
+}
+
+// --- Model ---
+
+// HostArray: Points *view at a host-order, 4-aligned copy of the count 4-byte
+// values there when the buffer cannot be used in place: on big-endian hosts, or
+// when the data before the array (a skin whose width is not a multiple of 4)
+// leaves it unaligned for stvert_t and dtriangle_t access.
+static mdlerror_t HostArray (mdl_t *model, const void **view, size_t count, const char *what)
+{
+    if (!count || (!MDL_BIG_ENDIAN && ((size_t)*view & 3) == 0))
+        return MDL_OK;
+    void *copy = ModelAlloc(model, count * 4);
+    if (!copy)
+        return SetError(model, MDL_ERR_NOMEM, "out of memory for %s", what);
+    MDL_LittleLongs(copy, *view, count);
+    *view = copy;
+    return MDL_OK;
+}
+
+// OwnsArray: Whether HostArray made a copy of an array rather than using the buffer.
+static qboolean OwnsArray (const mdl_t *model, const void *array)
+{
+    const byte *p = (const byte *)array;
+    return p && (p < model->data || p >= model->data + model->size);
+}
+
+// FreeTables: Releases what ParseModel allocated.
+static void FreeTables (mdl_t *model)
+{
+    ModelFree(model, model->skins);
+    ModelFree(model, model->frames);
+    if (OwnsArray(model, model->st_verts))
+        ModelFree(model, (void *)model->st_verts);
+    if (OwnsArray(model, model->triangles))
+        ModelFree(model, (void *)model->triangles);
+    model->st_verts = NULL;
+    model->triangles = NULL;
+    model->skins = NULL;
+    model->frames = NULL;
+    model->numskins = 0;
+    model->numframes = 0;
+}
+
+// ParseModel: The body of MDL_LoadModel; tables it allocates are released by the caller on failure.
+static mdlerror_t ParseModel (mdl_t *model)
+{
+    const mdl_header_t *header = &model->header;
+    size_t pos = sizeof(*header);
+    const void *view = NULL;
+    mdlerror_t error;
+
+    // Skins: count them, then walk them again to fill the table
+    size_t skinstart = pos;
+    if ((error = WalkSkins(model, &pos, NULL, &model->numskins)) != MDL_OK)
+        return error;
+    model->skins = (mdlskin_t *)ModelAlloc(model, (size_t)model->numskins * sizeof(mdlskin_t));
+    if (!model->skins)
+        return SetError(model, MDL_ERR_NOMEM, "out of memory for %d skins", model->numskins);
+    pos = skinstart;
+    if ((error = WalkSkins(model, &pos, model->skins, &model->numskins)) != MDL_OK)
+        return error;
+
+    if ((error = TakeArray(model, &pos, header->numverts, sizeof(stvert_t), "ST vertices", &view)) != MDL_OK
+        || (error = HostArray(model, &view, (size_t)header->numverts * 3, "ST vertices")) != MDL_OK)
+        return error;
+    model->st_verts = (const stvert_t *)view;
+    if ((error = TakeArray(model, &pos, header->numtris, sizeof(dtriangle_t), "triangles", &view)) != MDL_OK
+        || (error = HostArray(model, &view, (size_t)header->numtris * 4, "triangles")) != MDL_OK)
+        return error;
+    model->triangles = (const dtriangle_t *)view;
+    if ((error = MDL_CheckTriangles(model)) != MDL_OK)
+        return error;
+
+    // Frames: count them, then walk them again to fill the table
+    size_t framestart = pos;
+    if ((error = WalkFrames(model, &pos, NULL, &model->numframes)) != MDL_OK)
+        return error;
+    model->modelsize = pos;
+    model->frames = (mdlframe_t *)ModelAlloc(model, (size_t)model->numframes * sizeof(mdlframe_t));
+    if (!model->frames)
+        return SetError(model, MDL_ERR_NOMEM, "out of memory for %d frames", model->numframes);
+    pos = framestart;
+    return WalkFrames(model, &pos, model->frames, &model->numframes);
+}
+
+mdlerror_t MDL_LoadModel (mdl_t *model, const void *data, size_t size, const mdlallocator_t *allocator)
+{
+    mdlerror_t error;
+
+    memset(model, 0, sizeof(*model));
+    model->allocator = allocator ? *allocator : default_allocator;
+    if ((error = MDL_ReadHeader(model, data, size)) != MDL_OK)
+        return error;
+    if ((error = ParseModel(model)) != MDL_OK)
+        FreeTables(model); // Keep the header and the message for the caller
+    return error;
+}
+
+mdlerror_t MDL_ScanModel (mdl_t *model, const void *data, size_t size)
+{
+    const void *view = NULL;
+    mdlerror_t error;
+
+    memset(model, 0, sizeof(*model));
+    model->allocator = default_allocator;
+    if ((error = MDL_ReadHeader(model, data, size)) != MDL_OK)
+        return error;
+    size_t pos = sizeof(model->header);
+    if ((error = WalkSkins(model, &pos, NULL, &model->numskins)) != MDL_OK
+        || (error = TakeArray(model, &pos, model->header.numverts, sizeof(stvert_t), "ST vertices", &view)) != MDL_OK
+        || (error = TakeArray(model, &pos, model->header.numtris, sizeof(dtriangle_t), "triangles", &view)) != MDL_OK
+        || (error = WalkFrames(model, &pos, NULL, &model->numframes)) != MDL_OK)
+        return error;
+    model->modelsize = pos;
+    return MDL_OK;
+}
+
+void MDL_FreeModel (mdl_t *model)
+{
+    FreeTables(model);
+}
+
+const byte *MDL_SkinPixels (const mdl_t *model, const mdlskin_t *skin)
+{
+    return model->data + skin->offset;
+}
+
+const trivertx_t *MDL_FrameVerts (const mdl_t *model, const mdlframe_t *frame)
+{
+    return (const trivertx_t *)(model->data + frame->offset + sizeof(daliasframe_t));
+}
+
+void MDL_FrameBounds (const mdl_t *model, const mdlframe_t *frame, vec3_t mins, vec3_t maxs)
+{
+    const daliasframe_t *info = (const daliasframe_t *)(model->data + frame->offset);
+    const mdl_header_t *header = &model->header;
+    for (int k = 0; k < 3; k++) {
+        mins[k] = info->bboxmin.v[k] * header->scale[k] + header->scale_origin[k];
+        maxs[k] = info->bboxmax.v[k] * header->scale[k] + header->scale_origin[k];
+    }
+}
+
+// --- Frame Decoding ---
+// A frame is decoded by dequantizing every trivertx_t exactly once into
+// structure-of-arrays float buffers; normals are looked up or recomputed next to
+// them. Output writers gather whatever layout they need from those.
+
+// MDL_DequantizeVerts: out = v * scale + scale_origin for every vertex, 4 (SSE2) or
+// 8 (NEON) vertices at a time. This reverses the scaling and translation applied
+// by modelgen.c: original_float_v = (byte_v * header.scale[k]) + header.scale_origin[k]
+void MDL_DequantizeVerts (const trivertx_t *in, int numverts, const vec3_t scale, const vec3_t scale_origin,
+                          float *x, float *y, float *z)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128 sx = _mm_set1_ps(scale[0]), sy = _mm_set1_ps(scale[1]), sz = _mm_set1_ps(scale[2]);
+    const __m128 ox = _mm_set1_ps(scale_origin[0]), oy = _mm_set1_ps(scale_origin[1]), oz = _mm_set1_ps(scale_origin[2]);
+    for ( ; i + 4 <= numverts; i += 4) {
+        // 4 trivertx_t = 16 bytes; each 32-bit lane holds x | y << 8 | z << 16 | normal << 24
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128 fx = _mm_cvtepi32_ps(_mm_and_si128(v, mask));
+        __m128 fy = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 8), mask));
+        __m128 fz = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 16), mask));
+#if defined(__FMA__)
+        _mm_storeu_ps(x + i, _mm_fmadd_ps(fx, sx, ox));
+        _mm_storeu_ps(y + i, _mm_fmadd_ps(fy, sy, oy));
+        _mm_storeu_ps(z + i, _mm_fmadd_ps(fz, sz, oz));
+#else
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_mul_ps(fx, sx), ox));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(fy, sy), oy));
+        _mm_storeu_ps(z + i, _mm_add_ps(_mm_mul_ps(fz, sz), oz));
+#endif
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t sx = vdupq_n_f32(scale[0]), sy = vdupq_n_f32(scale[1]), sz = vdupq_n_f32(scale[2]);
+    const float32x4_t ox = vdupq_n_f32(scale_origin[0]), oy = vdupq_n_f32(scale_origin[1]), oz = vdupq_n_f32(scale_origin[2]);
+    for ( ; i + 8 <= numverts; i += 8) {
+        uint8x8x4_t v = vld4_u8((const uint8_t *)(in + i)); // De-interleaves x, y, z, normal
+        uint16x8_t wx = vmovl_u8(v.val[0]), wy = vmovl_u8(v.val[1]), wz = vmovl_u8(v.val[2]);
+        vst1q_f32(x + i,     vmlaq_f32(ox, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wx))), sx));
+        vst1q_f32(x + i + 4, vmlaq_f32(ox, vcvtq_f32_u32(vmovl_u16(vget_high_u16(wx))), sx));
+        vst1q_f32(y + i,     vmlaq_f32(oy, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wy))), sy));
+        vst1q_f32(y + i + 4, vmlaq_f32(oy, vcvtq_f32_u32(vmovl_u16(vget_high_u16(wy))), sy));
+        vst1q_f32(z + i,     vmlaq_f32(oz, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wz))), sz));
+        vst1q_f32(z + i + 4, vmlaq_f32(oz, vcvtq_f32_u32(vmovl_u16(vget_high_u16(wz))), sz));
+    }
+#endif
+    for ( ; i < numverts; i++) {
+        x[i] = (float)in[i].v[0] * scale[0] + scale_origin[0];
+        y[i] = (float)in[i].v[1] * scale[1] + scale_origin[1];
+        z[i] = (float)in[i].v[2] * scale[2] + scale_origin[2];
+    }
+}
+
+// Rows are padded to 4 floats, so one aligned load fetches a normal. Indices past
+// NUMVERTEXNORMALS are left as zero vectors and need no range check.
+static const float anorms[256][4] __attribute__((aligned(16))) = {
+#include "anorms.h"
+};
+
+// LookupNormals: Fetches the table normal of every vertex into SoA buffers, one
+// 16-byte load per vertex and a 4x4 transpose per 4 vertices.
+static void LookupNormals (const trivertx_t *in, int numverts, float *nx, float *ny, float *nz)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    for ( ; i + 4 <= numverts; i += 4) {
+        __m128 r0 = _mm_load_ps(anorms[in[i].lightnormalindex]);
+        __m128 r1 = _mm_load_ps(anorms[in[i + 1].lightnormalindex]);
+        __m128 r2 = _mm_load_ps(anorms[in[i + 2].lightnormalindex]);
+        __m128 r3 = _mm_load_ps(anorms[in[i + 3].lightnormalindex]);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(nx + i, r0);
+        _mm_storeu_ps(ny + i, r1);
+        _mm_storeu_ps(nz + i, r2);
+    }
+#elif defined(__ARM_NEON)
+    for ( ; i + 4 <= numverts; i += 4) {
+        float32x4x2_t t01 = vtrnq_f32(vld1q_f32(anorms[in[i].lightnormalindex]), vld1q_f32(anorms[in[i + 1].lightnormalindex]));
+        float32x4x2_t t23 = vtrnq_f32(vld1q_f32(anorms[in[i + 2].lightnormalindex]), vld1q_f32(anorms[in[i + 3].lightnormalindex]));
+        vst1q_f32(nx + i, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+        vst1q_f32(ny + i, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+        vst1q_f32(nz + i, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+    }
+#endif
+    for ( ; i < numverts; i++) {
+        const float *n = anorms[in[i].lightnormalindex];
+        nx[i] = n[0];
+        ny[i] = n[1];
+        nz[i] = n[2];
+    }
+}
+
+// SmoothNormals: Recomputes the normals of a decoded frame in one pass over its
+// triangles: every face normal, weighted by the face's area, is added to its three
+// vertices, and the sums are normalized. Quake's front faces are clockwise.
+static void SmoothNormals (const mdl_t *model, decodedframe_t *frame)
+{
+    const dtriangle_t *tris = model->triangles;
+    int numverts = frame->numverts;
+
+    memset(frame->nx, 0, numverts * sizeof(float));
+    memset(frame->ny, 0, numverts * sizeof(float));
+    memset(frame->nz, 0, numverts * sizeof(float));
+    for (int t = 0; t < model->header.numtris; t++) {
+        const int *vi = tris[t].vertindex;
+        vec3_t p[3], e1, e2, normal;
+        for (int k = 0; k < 3; k++) {
+            p[k][0] = frame->x[vi[k]];
+            p[k][1] = frame->y[vi[k]];
+            p[k][2] = frame->z[vi[k]];
+        }
+        VectorSubtract(p[1], p[0], e1);
+        VectorSubtract(p[2], p[0], e2);
+        CrossProduct(e2, e1, normal);
+        for (int k = 0; k < 3; k++) {
+            frame->nx[vi[k]] += normal[0];
+            frame->ny[vi[k]] += normal[1];
+            frame->nz[vi[k]] += normal[2];
+        }
+    }
+    for (int v = 0; v < numverts; v++) {
+        vec3_t normal = { frame->nx[v], frame->ny[v], frame->nz[v] };
+        VectorNormalize(normal);
+        frame->nx[v] = normal[0];
+        frame->ny[v] = normal[1];
+        frame->nz[v] = normal[2];
+    }
+}
+
+void MDL_DecodeNormals (const mdl_t *model, normalmode_t normals, decodedframe_t *frame)
+{
+    if (normals == NORMALS_TABLE)
+        LookupNormals(frame->raw, frame->numverts, frame->nx, frame->ny, frame->nz);
+    else if (normals == NORMALS_SMOOTH)
+        SmoothNormals(model, frame);
+}
+
+mdlerror_t MDL_DecodeFrame (const mdl_t *model, int frame, normalmode_t normals, decodedframe_t *out)
+{
+    if (frame < 0 || frame >= model->numframes)
+        return MDL_ERR_RANGE;
+    out->numverts = model->header.numverts;
+    out->raw = MDL_FrameVerts(model, &model->frames[frame]);
+    MDL_DequantizeVerts(out->raw, out->numverts, model->header.scale, model->header.scale_origin, out->x, out->y, out->z);
+    MDL_DecodeNormals(model, normals, out);
+    return MDL_OK;
+}
+
+// --- Texture Coordinates ---
+
+// MDL_BuildUVTable: Resolves the texture coordinates of every triangle corner once per
+// model into uvs (numtris * 3 pairs), which every frame and output then shares.
+// As in GL_MakeAliasModelDisplayLists, a seam vertex seen by a back-facing
+// triangle samples the back half of the skin, and coordinates address texel
+// centers: u = (s + 0.5) / skinwidth, v = (t + 0.5) / skinheight, v from the top.
+void MDL_BuildUVTable (const mdl_t *model, float *uvs)
+{
+    const mdl_header_t *header = &model->header;
+    float width = header->skinwidth > 0 ? (float)header->skinwidth : 1;
+    float height = header->skinheight > 0 ? (float)header->skinheight : 1;
+    int backoffset = header->skinwidth / 2;
+
+    for (int t = 0; t < header->numtris; t++) {
+        const dtriangle_t *tri = &model->triangles[t];
+        for (int k = 0; k < 3; k++, uvs += 2) {
+            const stvert_t *st = &model->st_verts[tri->vertindex[k]];
+            int s = st->s + (!tri->facesfront && st->onseam ? backoffset : 0);
+            uvs[0] = ((float)s + 0.5f) / width;
+            uvs[1] = ((float)st->t + 0.5f) / height;
+        }
+    }
+}
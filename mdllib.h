@@ -0,0 +1,238 @@
+// mdllib.h -- Quake MDL parsing library (libmdl.a)
+//
+// Parses an alias model from a buffer the caller owns, without copying it: the
+// model object points into the buffer for st_verts, triangles, skins and frame
+// vertices, and adds a skin table and a frame table (group sub-skins and
+// sub-frames get an entry each); on big-endian hosts, or when a skin width that is
+// not a multiple of 4 leaves them unaligned, st_verts and triangles are copies. Frames are decoded on demand. Nothing here exits or prints:
+// every function that can fail returns an mdlerror_t and leaves a message in
+// mdl_t.error. All memory comes from the caller's allocator.
+//
+// The model buffer must stay alive and unchanged until MDL_FreeModel.
+
+#ifndef __MDLLIB__
+#define __MDLLIB__
+
+#include <stddef.h>
+
+#ifndef __BYTEBOOL__
+#define __BYTEBOOL__
+typedef enum {false, true} qboolean;
+typedef unsigned char byte;
+#endif
+
+typedef float vec3_t[3];
+
+// --- Structures from modelgen.h, adapted for reading ---
+#define ALIAS_VERSION	6
+#define IDPOLYHEADER	(('O'<<24)+('P'<<16)+('D'<<8)+'I') // Little-endian "IDPO"
+
+
+typedef enum {ST_SYNC=0, ST_RAND } synctype_t;
+typedef enum { ALIAS_SINGLE=0, ALIAS_GROUP } aliasframetype_t;
+typedef enum { ALIAS_SKIN_SINGLE=0, ALIAS_SKIN_GROUP } aliasskintype_t; // Original struct uses an anonymous union for type
+
+// MDL Header structure
+typedef struct {
+	int			ident;
+	int			version;
+	vec3_t		scale;          // Model scale factor for vertex coordinates
+	vec3_t		scale_origin;   // Origin for scaling vertex coordinates
+	float		boundingradius;
+	vec3_t		eyeposition;
+	int			numskins;       // Number of skins
+	int			skinwidth;      // Width of the skin texture
+	int			skinheight;     // Height of the skin texture
+	int			numverts;       // Number of vertices
+	int			numtris;        // Number of triangles
+	int			numframes;      // Number of frame entries (a frame group counts once)
+	synctype_t	synctype;
+	int			flags;
+	float		size;
+} mdl_header_t;
+
+// ST vertex structure (for texture coordinates)
+typedef struct {
+	int		onseam;
+	int		s;
+	int		t;
+} stvert_t;
+
+// Triangle structure (indices to vertices)
+typedef struct {
+	int					facesfront;
+	int					vertindex[3]; // Indices into the vertex list
+} dtriangle_t;
+
+// Raw vertex data in MDL frames (byte-packed)
+typedef struct {
+	byte	v[3]; // X, Y, Z coordinates packed as bytes
+	byte	lightnormalindex; // Index into a predefined normal lookup table
+} trivertx_t;
+
+// Single animation frame header
+// Using __attribute__((packed)) to prevent compiler padding
+typedef struct __attribute__((packed)) {
+	trivertx_t	bboxmin;
+	trivertx_t	bboxmax;
+	char		name[16]; // Frame name
+} daliasframe_t;
+
+// Animation frame group header
+// Using __attribute__((packed)) to prevent compiler padding
+typedef struct __attribute__((packed)) {
+	int			numframes; // Placeholder value in original modelgen.c (often 0)
+	trivertx_t	bboxmin;
+	trivertx_t	bboxmax;
+} daliasgroup_t;
+
+// --- Errors ---
+typedef enum {
+    MDL_OK = 0,
+    MDL_ERR_TRUNCATED,  // The buffer ends before the data the model describes
+    MDL_ERR_IDENT,      // Not an IDPO version 6 model
+    MDL_ERR_HEADER,     // Negative or impossible counts in the header
+    MDL_ERR_TRIANGLE,   // A triangle references a vertex that does not exist
+    MDL_ERR_FRAME,      // Unknown frame type or absurd frame group size
+    MDL_ERR_NOMEM,      // The allocator returned NULL
+    MDL_ERR_RANGE,      // Frame index out of range
+    MDL_ERR_SKIN,       // Unknown skin type or absurd skin group size
+    NUM_MDL_ERRORS
+} mdlerror_t;
+
+#define MDL_ERROR_SIZE  256
+
+// --- Allocators ---
+// alloc returns NULL on failure. free may be NULL for allocators that release
+// everything at once (arenas). A NULL mdlallocator_t * means malloc and free.
+typedef struct {
+    void    *(*alloc) (void *opaque, size_t size);
+    void    (*free) (void *opaque, void *ptr);
+    void    *opaque;
+} mdlallocator_t;
+
+// --- Model Object ---
+typedef struct {
+    size_t  offset;     // Offset of the skin's pixels in the buffer
+    int     type;       // ALIAS_SKIN_SINGLE or ALIAS_SKIN_GROUP (the entry the skin came from)
+    int     group;      // Skin entry index, as used in the output file names
+    int     sub;        // Sub-skin index within a group, -1 for single skins
+    float   interval;   // Group skins: the time the skin ends, from the group's interval table; 0 for single skins
+} mdlskin_t;
+
+typedef struct {
+    size_t  offset;     // Offset of the frame's daliasframe_t in the buffer
+    int     type;       // ALIAS_SINGLE or ALIAS_GROUP (the entry the frame came from)
+    int     group;      // Frame entry index, as used in the output file names
+    int     sub;        // Sub-frame index within a group, -1 for single frames
+    char    name[17];   // daliasframe_t.name, null-terminated
+    float   interval;   // Group frames: the time the frame ends, from the group's interval table; 0 for single frames
+} mdlframe_t;
+
+typedef struct {
+    const byte          *data;      // The model buffer (not owned)
+    size_t              size;
+    size_t              modelsize;  // Bytes the model occupies; size when nothing trails it
+    mdl_header_t        header;
+    mdlskin_t           *skins;     // numskins entries
+    int                 numskins;   // Skins, counting every group sub-skin
+    const stvert_t      *st_verts;  // header.numverts entries, in the buffer (an aligned host-order copy on big-endian hosts or when unaligned)
+    const dtriangle_t   *triangles; // header.numtris entries, likewise; indices are checked
+    mdlframe_t          *frames;    // numframes entries
+    int                 numframes;  // Frames, counting every group sub-frame
+    mdlallocator_t      allocator;
+    char                error[MDL_ERROR_SIZE];
+} mdl_t;
+
+// A frame decoded into structure-of-arrays buffers the caller supplies
+typedef struct {
+    int                 numverts;
+    float               *x, *y, *z;     // Dequantized positions
+    float               *nx, *ny, *nz;  // Vertex normals, or NULL with NORMALS_NONE
+    const trivertx_t    *raw;           // Source vertices (for lightnormalindex)
+} decodedframe_t;
+
+// Vertex normals come from Quake's table of 162 precomputed normals, which every
+// trivertx_t indexes with lightnormalindex, or are recomputed from the frame's faces.
+#define NUMVERTEXNORMALS    162
+
+typedef enum { NORMALS_NONE, NORMALS_TABLE, NORMALS_SMOOTH } normalmode_t;
+
+// --- Byte Order ---
+// MDL, .pak and glTF data is little-endian; .tri and LBM files are big-endian.
+// The host's byte order is fixed at compile time, so converting from or to the
+// order the host already uses is a copy, or nothing when done in place. Every
+// conversion is its own inverse: the same call reads and writes. out may be in;
+// neither needs to be aligned.
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) || defined(__BIG_ENDIAN__)
+#define MDL_BIG_ENDIAN  1
+#else
+#define MDL_BIG_ENDIAN  0
+#endif
+
+// MDL_SwapLongs: Reverses the byte order of count 4-byte values, 4 at a time with
+// SSE or NEON.
+void MDL_SwapLongs (void *out, const void *in, size_t count);
+
+// MDL_LittleLongs: Converts count 4-byte values between little-endian and host order.
+void MDL_LittleLongs (void *out, const void *in, size_t count);
+
+// MDL_BigLongs: Converts count 4-byte values between big-endian and host order.
+void MDL_BigLongs (void *out, const void *in, size_t count);
+
+// MDL_CheckByteOrder: false if the host's byte order is not the one MDL_BIG_ENDIAN
+// was set for at compile time.
+qboolean MDL_CheckByteOrder (void);
+
+// --- Parsing ---
+
+// MDL_ReadHeader: Copies the header out of the buffer and validates it, including
+// that the buffer is at least as large as its counts require. model->header is
+// filled in even when the header is rejected.
+mdlerror_t MDL_ReadHeader (mdl_t *model, const void *data, size_t size);
+
+// MDL_LoadModel: Parses a whole model and builds its skin and frame tables. On
+// failure everything allocated is released again and model->error says why.
+mdlerror_t MDL_LoadModel (mdl_t *model, const void *data, size_t size, const mdlallocator_t *allocator);
+
+// MDL_ScanModel: Walks a model like MDL_LoadModel, but only counts the skins and
+// frames and finds modelsize: nothing is allocated, no tables are built and the
+// triangles are not checked. model needs no MDL_FreeModel.
+mdlerror_t MDL_ScanModel (mdl_t *model, const void *data, size_t size);
+
+// MDL_CheckTriangles: Checks every vertex index once, so the frame loops can use
+// them unchecked. MDL_LoadModel does this already.
+mdlerror_t MDL_CheckTriangles (mdl_t *model);
+
+// MDL_FreeModel: Releases the tables of a loaded model.
+void MDL_FreeModel (mdl_t *model);
+
+const char *MDL_ErrorString (mdlerror_t error);
+
+// --- Decoding ---
+
+// MDL_SkinPixels: The skinwidth * skinheight palette indices of a skin.
+const byte *MDL_SkinPixels (const mdl_t *model, const mdlskin_t *skin);
+
+// MDL_FrameVerts: The numverts quantized vertices of a frame.
+const trivertx_t *MDL_FrameVerts (const mdl_t *model, const mdlframe_t *frame);
+
+// MDL_FrameBounds: The dequantized bboxmin and bboxmax of a frame's daliasframe_t,
+// read from the frame header alone.
+void MDL_FrameBounds (const mdl_t *model, const mdlframe_t *frame, vec3_t mins, vec3_t maxs);
+
+// MDL_DecodeFrame: Decodes frames[frame] into out, whose x, y, z (and, unless
+// normals is NORMALS_NONE, nx, ny, nz) buffers hold numverts floats each.
+mdlerror_t MDL_DecodeFrame (const mdl_t *model, int frame, normalmode_t normals, decodedframe_t *out);
+
+// MDL_DequantizeVerts: out = v * scale + scale_origin for every vertex, in SoA form.
+void MDL_DequantizeVerts (const trivertx_t *in, int numverts, const vec3_t scale, const vec3_t scale_origin,
+                          float *x, float *y, float *z);
+
+// MDL_DecodeNormals: Fills the normals of a frame whose positions are decoded.
+void MDL_DecodeNormals (const mdl_t *model, normalmode_t normals, decodedframe_t *frame);
+
+// MDL_BuildUVTable: Resolves the u, v of every triangle corner (numtris * 3 pairs).
+void MDL_BuildUVTable (const mdl_t *model, float *uvs);
+
+#endif